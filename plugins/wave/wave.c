@@ -0,0 +1,52 @@
+/*
+ * Example effect plugin: a sine wave travelling along the channels.
+ *
+ * Build it on its own and point a channel at it:
+ *   gcc -shared -fPIC -O2 -I../../src wave.c -o libwave.so -lm
+ *   { "name": "Wave", "pattern": "plugin", "plugin": "plugins/wave/libwave.so" }
+ * Rebuilding libwave.so while the application runs reloads it.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include "effect_plugin_api.h"
+
+typedef struct WaveState
+{
+    double speed; /* Radians per second */
+} WaveState;
+
+static void *waveInit(uint32_t channelCount, uint64_t seed)
+{
+    (void)channelCount;
+    (void)seed;
+    WaveState *state = malloc(sizeof(WaveState));
+    if (state != NULL)
+    {
+        state->speed = 2.0;
+    }
+    return state;
+}
+
+static void waveEvaluate(void *opaque, const PwmEffectBatch *batch)
+{
+    const WaveState *state = opaque;
+    const double speed = state != NULL ? state->speed : 2.0;
+    for (uint32_t k = 0; k < batch->count; ++k)
+    {
+        const double half = batch->range[k] / 2.0;
+        const double phase = batch->time * speed + batch->index[k] * 0.5;
+        batch->out[k] = (int32_t)(half + half * sin(phase) + 0.5);
+    }
+}
+
+static void waveDestroy(void *state)
+{
+    free(state);
+}
+
+static const PwmEffectPlugin WAVE_PLUGIN = {PWM_EFFECT_API_VERSION, "wave", waveInit, waveEvaluate, waveDestroy};
+
+const PwmEffectPlugin *pwm_effect_plugin(void)
+{
+    return &WAVE_PLUGIN;
+}
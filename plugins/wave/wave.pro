@@ -0,0 +1,10 @@
+# Example effect plugin; builds libwave.so next to this file
+TEMPLATE = lib
+CONFIG += plugin
+CONFIG -= qt
+TARGET = wave
+
+INCLUDEPATH += ../../src
+SOURCES += wave.c
+HEADERS += ../../src/effect_plugin_api.h
+LIBS += -lm
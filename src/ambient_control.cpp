@@ -0,0 +1,85 @@
+#include "ambient_control.h"
+
+#include <algorithm> // std::clamp, std::max
+#include <cmath>     // std::fabs
+
+AmbientController::AmbientController(const AmbientConfig &config, double gain)
+    : m_config{config}, m_integral{std::clamp(gain, config.minGain, 1.0)}
+{
+    m_stats.gain = m_integral;
+}
+
+double AmbientController::update(double lux, double time)
+{
+    const double measured{lux / m_config.target};
+    const double error{1.0 - measured};
+    const double dt{m_lastMeasured >= 0.0 ? time - m_lastTime : 0.0};
+    const double derivative{dt > 0.0 ? (measured - m_lastMeasured) / dt : 0.0};
+
+    const double proportional{m_config.kp * error - m_config.kd * derivative};
+    const double integral{m_integral + m_config.ki * error * dt};
+    const double gain{proportional + integral};
+    // Conditional integration: only while the result is not pushing further into a limit
+    if ((gain < 1.0 || error < 0.0) && (gain > m_config.minGain || error > 0.0))
+    {
+        m_integral = std::clamp(integral, m_config.minGain, 1.0);
+    }
+
+    m_lastMeasured = measured;
+    m_lastTime = time;
+    ++m_stats.steps;
+    m_stats.lux = lux;
+    m_stats.error = error;
+    m_stats.gain = std::clamp(gain, m_config.minGain, 1.0);
+    trackSettling(time);
+    return m_stats.gain;
+}
+
+void AmbientController::hold()
+{
+    ++m_stats.steps;
+    ++m_stats.missed;
+}
+
+void AmbientController::recordTiming(double stepUs, double lateMs)
+{
+    m_stats.maxStepUs = std::max(m_stats.maxStepUs, stepUs);
+    m_stats.totalStepUs += stepUs;
+    m_stats.maxLateMs = std::max(m_stats.maxLateMs, lateMs);
+}
+
+void AmbientController::trackSettling(double time)
+{
+    const double error{std::fabs(m_stats.error)};
+    if (error > DISTURBANCE_ERROR)
+    {
+        if (m_disturbedAt < 0.0)
+        {
+            m_disturbedAt = time;
+        }
+        m_settledSteps = 0;
+        return;
+    }
+    if (m_disturbedAt < 0.0)
+    {
+        return;
+    }
+
+    if (error > SETTLED_ERROR)
+    {
+        m_settledSteps = 0;
+        return;
+    }
+    if (m_settledSteps++ == 0)
+    {
+        m_settlingSince = time;
+    }
+    if (m_settledSteps >= SETTLE_STEPS)
+    {
+        m_stats.lastSettleS = m_settlingSince - m_disturbedAt;
+        m_stats.maxSettleS = std::max(m_stats.maxSettleS, m_stats.lastSettleS);
+        ++m_stats.settled;
+        m_disturbedAt = -1.0;
+        m_settledSteps = 0;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <memory>  // Shared sensor
+#include <string>  // Zone name
+#include "light_sensor.h"
+
+/**
+ * The ambient light loop of a rig: the light at the sensor is held at
+ * target by scaling the outputs of a zone, or of every channel. The gain
+ * only ever dims (minGain–1), so the faders still set the most light
+ * there can be.
+ */
+struct AmbientConfig
+{
+    std::shared_ptr<LightSensor> sensor; // nullptr = no loop
+    double target{300.0};                // Lux at the sensor
+    std::string zone;                    // Empty = every channel
+    int intervalMs{100};                 // Control period, rounded to whole frames
+    double kp{0.3};                      // Gain per unit of relative error
+    double ki{1.0};                      // Gain per unit of relative error and second
+    double kd{0.0};                      // Gain per unit of relative error change per second
+    double minGain{0.05};
+};
+
+// How the loop has been doing since the config was loaded
+struct AmbientStats
+{
+    std::size_t steps{0};
+    std::size_t missed{0};    // Steps without a sensor reading, which held the gain
+    double lux{0.0};          // Last reading
+    double gain{1.0};
+    double error{0.0};        // (target - lux) / target of the last step
+    double maxStepUs{0.0};    // Longest step on the engine thread
+    double totalStepUs{0.0};
+    double maxLateMs{0.0};    // Latest a step came after its due time
+    std::size_t settled{0};   // Disturbances brought back within SETTLED_ERROR
+    double lastSettleS{0.0};  // Engine time from the last disturbance to settling
+    double maxSettleS{0.0};
+};
+
+/**
+ * PID controller of the ambient loop, on the relative error so the gains
+ * do not depend on the target. The derivative acts on the reading, so a
+ * new target does not kick the gain, and the integral stops while the
+ * gain is pinned at a limit, so it does not wind up in bright daylight.
+ *
+ * A disturbance is an error beyond DISTURBANCE_ERROR; it counts as
+ * settled once the error stays within SETTLED_ERROR for SETTLE_STEPS.
+ */
+class AmbientController
+{
+public:
+    static constexpr double DISTURBANCE_ERROR{0.10};
+    static constexpr double SETTLED_ERROR{0.02};
+    static constexpr int SETTLE_STEPS{5};
+
+    // Starts from gain, so a reload carries on from where the loop was
+    AmbientController(const AmbientConfig &config, double gain);
+
+    // One step with a reading taken at engine time; returns the new gain
+    double update(double lux, double time);
+    // A step without a reading: the gain stays
+    void hold();
+    void recordTiming(double stepUs, double lateMs);
+
+    double gain() const { return m_stats.gain; }
+    const AmbientStats &stats() const { return m_stats; }
+
+private:
+    void trackSettling(double time);
+
+    AmbientConfig m_config;
+    double m_integral;
+    double m_lastMeasured{-1.0}; // Relative reading of the previous step, -1 = none
+    double m_lastTime{0.0};
+    double m_disturbedAt{-1.0};  // Engine time of the open disturbance, -1 = none
+    double m_settlingSince{0.0};
+    int m_settledSteps{0};
+    AmbientStats m_stats;
+};
@@ -0,0 +1,93 @@
+#include "channel_delegate.h"
+
+#include <QApplication> // Application style used to draw the slider
+#include <QMouseEvent>  // Mouse input on the painted slider
+#include <QPainter>     // Row painting
+#include "channel_model.h"
+
+// Row layout: fixed-width label column followed by the slider
+constexpr int ROW_HEIGHT{32};
+constexpr int LABEL_WIDTH{110};
+constexpr int ROW_MARGIN{6};
+
+QStyleOptionSlider ChannelDelegate::sliderOption(const QStyleOptionViewItem &option,
+                                                 const QModelIndex &index) const
+{
+    QStyleOptionSlider slider;
+    slider.initFrom(option.widget);
+    slider.rect = option.rect.adjusted(LABEL_WIDTH, ROW_MARGIN, -ROW_MARGIN, -ROW_MARGIN);
+    slider.orientation = Qt::Horizontal;
+    slider.minimum = 0;
+    slider.maximum = index.data(ChannelModel::RangeRole).toInt(); // Range for PWM (duty cycle)
+    slider.sliderPosition = index.data(ChannelModel::DutyRole).toInt();
+    slider.sliderValue = slider.sliderPosition;
+    slider.subControls = QStyle::SC_SliderGroove | QStyle::SC_SliderHandle;
+
+    // Automatically driven channels are shown, but cannot be dragged
+    if (!index.data(ChannelModel::ManualRole).toBool())
+    {
+        slider.state &= ~QStyle::State_Enabled;
+    }
+    return slider;
+}
+
+void ChannelDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                            const QModelIndex &index) const
+{
+    painter->save();
+
+    QRect labelRect{option.rect.adjusted(ROW_MARGIN, 0, 0, 0)};
+    labelRect.setWidth(LABEL_WIDTH - ROW_MARGIN);
+    painter->setFont(QFont{"Arial", 11});
+    painter->setPen(Qt::white);
+    painter->drawText(labelRect, Qt::AlignVCenter | Qt::AlignLeft,
+                      index.data(Qt::DisplayRole).toString());
+
+    const QStyleOptionSlider slider{sliderOption(option, index)};
+    QStyle *style{option.widget ? option.widget->style() : QApplication::style()};
+    style->drawComplexControl(QStyle::CC_Slider, &slider, painter, option.widget);
+
+    painter->restore();
+}
+
+QSize ChannelDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &) const
+{
+    return QSize{option.rect.width(), ROW_HEIGHT};
+}
+
+/**
+ * Handles clicks and drags on the painted slider of manual channels.
+ */
+bool ChannelDelegate::editorEvent(QEvent *event, QAbstractItemModel *model,
+                                  const QStyleOptionViewItem &option, const QModelIndex &index)
+{
+    if (event->type() != QEvent::MouseButtonPress && event->type() != QEvent::MouseMove)
+    {
+        return false;
+    }
+
+    const auto *mouse{static_cast<QMouseEvent *>(event)};
+    if (!(mouse->buttons() & Qt::LeftButton) || !(model->flags(index) & Qt::ItemIsEditable))
+    {
+        return false;
+    }
+
+    const QStyleOptionSlider slider{sliderOption(option, index)};
+    QStyle *style{option.widget ? option.widget->style() : QApplication::style()};
+    const QRect groove{style->subControlRect(QStyle::CC_Slider, &slider,
+                                             QStyle::SC_SliderGroove, option.widget)};
+    const QRect handle{style->subControlRect(QStyle::CC_Slider, &slider,
+                                             QStyle::SC_SliderHandle, option.widget)};
+
+    // Ignore presses that start on the label column
+    if (event->type() == QEvent::MouseButtonPress && !slider.rect.contains(mouse->pos()))
+    {
+        return false;
+    }
+
+    const int span{groove.width() - handle.width()};
+    const int position{mouse->pos().x() - groove.x() - handle.width() / 2};
+    const int value{QStyle::sliderValueFromPosition(slider.minimum, slider.maximum,
+                                                    position, span)};
+    return model->setData(index, value, ChannelModel::DutyRole);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QStyledItemDelegate> // Custom painting of channel rows
+#include <QStyleOptionSlider>  // Slider geometry and painting without a QSlider
+
+/**
+ * Paints each channel row as "label + slider" without creating widgets.
+ * The view only calls paint() for visible rows, so a thousand channels cost
+ * the same to draw as ten. Mouse input on manual rows is translated into
+ * duty values directly in editorEvent().
+ */
+class ChannelDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+protected:
+    bool editorEvent(QEvent *event, QAbstractItemModel *model,
+                     const QStyleOptionViewItem &option, const QModelIndex &index) override;
+
+private:
+    QStyleOptionSlider sliderOption(const QStyleOptionViewItem &option,
+                                    const QModelIndex &index) const;
+};
@@ -0,0 +1,128 @@
+#include "channel_model.h"
+
+#include <algorithm> // std::min / std::max for the dirty row range
+
+// Change notifications are flushed at most once per display frame (~60 Hz)
+constexpr int FRAME_INTERVAL_MS{16};
+
+ChannelModel::ChannelModel(PwmEngine &engine, QObject *parent)
+    : QAbstractListModel{parent}, m_engine{engine}
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FRAME_INTERVAL_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &ChannelModel::flushDirtyRows);
+
+    // Manual rows follow the slider value, automatic rows the blended level
+    m_listenerId = m_engine.addDutyListener([this](std::size_t index)
+                                            { markDirty(static_cast<int>(index)); });
+    m_outputListenerId = m_engine.addOutputListener([this](std::size_t index)
+                                                    { markDirty(static_cast<int>(index)); });
+
+    // A config reload may change every row, so the views start over
+    m_layoutListenerId = m_engine.addLayoutListener([this](bool done)
+                                                    {
+        if (!done) {
+            beginResetModel();
+            return;
+        }
+        m_dirtyFirst = -1;
+        m_dirtyLast = -1;
+        endResetModel(); });
+}
+
+ChannelModel::~ChannelModel()
+{
+    m_engine.removeDutyListener(m_listenerId);
+    m_engine.removeOutputListener(m_outputListenerId);
+    m_engine.removeLayoutListener(m_layoutListenerId);
+}
+
+int ChannelModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_engine.channelCount());
+}
+
+QVariant ChannelModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+    {
+        return {};
+    }
+
+    const Channel &channel{m_engine.channel(static_cast<std::size_t>(index.row()))};
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return QString::fromStdString(channel.name);
+    case DutyRole:
+        return channel.manual ? channel.duty : channel.level;
+    case ManualRole:
+        return channel.manual;
+    case RangeRole:
+        return channel.range;
+    default:
+        return {};
+    }
+}
+
+bool ChannelModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != DutyRole || !(flags(index) & Qt::ItemIsEditable))
+    {
+        return false;
+    }
+
+    // The engine listener takes care of the (batched) dataChanged() signal
+    m_engine.setDuty(static_cast<std::size_t>(index.row()), value.toInt());
+    return true;
+}
+
+Qt::ItemFlags ChannelModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+    {
+        return Qt::NoItemFlags;
+    }
+
+    Qt::ItemFlags result{Qt::ItemIsEnabled};
+    if (m_engine.channel(static_cast<std::size_t>(index.row())).manual)
+    {
+        result |= Qt::ItemIsEditable;
+    }
+    return result;
+}
+
+/**
+ * Records a changed row. Many changes inside one frame collapse into a
+ * single contiguous range that is reported when the frame timer fires.
+ */
+void ChannelModel::markDirty(int row)
+{
+    if (m_dirtyFirst < 0)
+    {
+        m_dirtyFirst = row;
+        m_dirtyLast = row;
+    }
+    else
+    {
+        m_dirtyFirst = std::min(m_dirtyFirst, row);
+        m_dirtyLast = std::max(m_dirtyLast, row);
+    }
+
+    if (!m_flushTimer.isActive())
+    {
+        m_flushTimer.start();
+    }
+}
+
+void ChannelModel::flushDirtyRows()
+{
+    if (m_dirtyFirst < 0)
+    {
+        return;
+    }
+
+    emit dataChanged(index(m_dirtyFirst), index(m_dirtyLast), {DutyRole});
+    m_dirtyFirst = -1;
+    m_dirtyLast = -1;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QAbstractListModel> // Model/view base class for the channel list
+#include <QTimer>             // Per-frame flush of batched change notifications
+#include "pwm_engine.h"
+
+/**
+ * Exposes the engine channels to a QListView.
+ * Only the rows a view actually shows are ever asked for data, so the cost
+ * of the panel no longer grows with the number of channels.
+ */
+class ChannelModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Role
+    {
+        DutyRole = Qt::UserRole + 1, // Current duty cycle (0–255)
+        ManualRole,                  // true if the row accepts slider input
+        RangeRole                    // Maximum duty value of the channel
+    };
+
+    explicit ChannelModel(PwmEngine &engine, QObject *parent = nullptr);
+    ~ChannelModel() override;
+
+    // Sets how often batched duty changes are reported to views
+    void setFlushInterval(int ms) { m_flushTimer.setInterval(ms); }
+
+    int rowCount(const QModelIndex &parent = QModelIndex{}) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private:
+    void markDirty(int row);
+    void flushDirtyRows();
+
+    PwmEngine &m_engine;
+    PwmEngine::ListenerId m_listenerId{};
+    PwmEngine::ListenerId m_outputListenerId{};
+    PwmEngine::ListenerId m_layoutListenerId{};
+
+    // Rows changed since the last frame, reported with one dataChanged()
+    QTimer m_flushTimer;
+    int m_dirtyFirst{-1};
+    int m_dirtyLast{-1};
+};
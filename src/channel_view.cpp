@@ -0,0 +1,44 @@
+#include "channel_view.h"
+
+#include <QMouseEvent> // Mouse drag handling
+#include <QPalette>    // Black list background
+
+ChannelView::ChannelView(QWidget *parent)
+    : QListView{parent}
+{
+    // All rows have the same height, which lets the view skip measuring
+    // every row on layout — the key to cheap startup with many channels.
+    setUniformItemSizes(true);
+    setSelectionMode(QAbstractItemView::NoSelection);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    setFrameShape(QFrame::NoFrame);
+
+    // Palette instead of a style sheet: same look, far less drawing work
+    QPalette palette{viewport()->palette()};
+    palette.setColor(QPalette::Base, Qt::black);
+    viewport()->setPalette(palette);
+}
+
+void ChannelView::mousePressEvent(QMouseEvent *event)
+{
+    m_dragIndex = indexAt(event->pos());
+    QListView::mousePressEvent(event);
+}
+
+void ChannelView::mouseMoveEvent(QMouseEvent *event)
+{
+    if ((event->buttons() & Qt::LeftButton) && m_dragIndex.isValid())
+    {
+        // Hands the move to ChannelDelegate::editorEvent for the pressed row
+        edit(m_dragIndex, QAbstractItemView::NoEditTriggers, event);
+        return;
+    }
+    QListView::mouseMoveEvent(event);
+}
+
+void ChannelView::mouseReleaseEvent(QMouseEvent *event)
+{
+    m_dragIndex = QPersistentModelIndex{};
+    QListView::mouseReleaseEvent(event);
+}
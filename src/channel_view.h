@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QListView>             // Scrolling, virtualized list of channel rows
+#include <QPersistentModelIndex> // Row currently being dragged
+
+/**
+ * List view for the channel panel. Rows are painted by ChannelDelegate;
+ * this class only routes slider drags back to the row that was pressed,
+ * since QAbstractItemView does not forward mouse moves to the delegate.
+ */
+class ChannelView : public QListView
+{
+    Q_OBJECT
+
+public:
+    explicit ChannelView(QWidget *parent = nullptr);
+
+protected:
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    QPersistentModelIndex m_dragIndex;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>   // One entry per layer
+#include <cstddef> // std::size_t
+#include <cstdint> // Fixed-width channel values
+#include <vector>  // Per-channel arrays
+
+// Layers in evaluation order; later layers are blended on top of earlier ones
+enum class Layer
+{
+    Base,     // Resting level from the configuration
+    Manual,   // Sliders and recalled scenes
+    Effects,  // Patterns such as the fade
+    Override, // Blackout and other forced values
+    Count
+};
+
+enum class BlendMode : std::uint8_t
+{
+    Htp,      // Highest takes precedence: max(below, layer)
+    Multiply, // below * layer / range
+    Add,      // below + layer, clipped to range
+    Replace   // layer
+};
+
+// Blend mode of each layer unless the configuration says otherwise
+constexpr std::array<BlendMode, static_cast<std::size_t>(Layer::Count)> DEFAULT_BLEND{
+    BlendMode::Replace, // Base
+    BlendMode::Htp,     // Manual
+    BlendMode::Htp,     // Effects
+    BlendMode::Replace  // Override
+};
+
+/**
+ * Combines the layers of every channel into one level per channel.
+ *
+ * Each layer is stored as contiguous per-channel arrays (structure of
+ * arrays), so evaluate() is a few straight loops that the compiler can
+ * vectorize. A channel only takes part in a layer once that layer has a
+ * value for it; layers that hold no value at all are skipped entirely.
+ */
+class Compositor
+{
+public:
+    static constexpr std::size_t LAYER_COUNT{static_cast<std::size_t>(Layer::Count)};
+
+    // Resets all layers for channels with the given PWM ranges
+    void reset(const std::vector<int> &ranges);
+
+    void setBlend(Layer layer, std::size_t channel, BlendMode mode);
+    void setValue(Layer layer, std::size_t channel, int value);
+    void clearValue(Layer layer, std::size_t channel);
+
+    int value(Layer layer, std::size_t channel) const;
+    bool hasValue(Layer layer, std::size_t channel) const
+    {
+        return m_layers[static_cast<std::size_t>(layer)].mask[channel] != 0;
+    }
+
+    // true if a layer changed since the last evaluate()
+    bool changed() const { return m_changed; }
+
+    // Blends all layers into levels (0–range per channel)
+    void evaluate(std::vector<std::uint32_t> &levels);
+
+    // Split evaluation: size levels, blend disjoint channel ranges (from any
+    // thread, as long as no layer changes meanwhile), then mark it done
+    void prepare(std::vector<std::uint32_t> &levels) const { levels.resize(m_range.size()); }
+    void evaluateRange(std::uint32_t *levels, std::size_t begin, std::size_t end) const;
+    void markEvaluated() { m_changed = false; }
+
+private:
+    struct LayerData
+    {
+        std::vector<std::uint32_t> value;  // 0–range
+        std::vector<std::uint32_t> factor; // value / range in 16.16 fixed point, for Multiply
+        std::vector<std::uint32_t> mask;   // All ones where the layer has a value
+        std::vector<std::uint32_t> mode;   // BlendMode, widened to keep the loop in 32-bit lanes
+        std::size_t activeCount{0};        // Number of channels with a value
+    };
+
+    static void blend(const LayerData &layer, const std::uint32_t *range, std::uint32_t *levels,
+                      std::size_t begin, std::size_t end);
+
+    std::array<LayerData, LAYER_COUNT> m_layers;
+    std::vector<std::uint32_t> m_range;
+    bool m_changed{true};
+};
@@ -0,0 +1,64 @@
+#include "config_watcher.h"
+
+#include <sys/inotify.h> // inotify_init1 / inotify_add_watch
+#include <unistd.h>      // read / close
+#include <cstring>       // std::strerror
+#include <cerrno>        // errno
+#include <stdexcept>     // For throwing runtime errors
+
+// Editors often write a file in several steps; wait for them to finish
+constexpr int SETTLE_MS{50};
+
+ConfigWatcher::ConfigWatcher(const std::string &path, QObject *parent)
+    : QObject{parent}
+{
+    const std::size_t slash{path.rfind('/')};
+    const std::string directory{slash == std::string::npos ? "." : path.substr(0, slash)};
+    m_fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0 || inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        const std::string reason{std::strerror(errno)};
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        throw std::runtime_error{"Cannot watch " + directory + ": " + reason};
+    }
+
+    m_settleTimer.setSingleShot(true);
+    m_settleTimer.setInterval(SETTLE_MS);
+    connect(&m_settleTimer, &QTimer::timeout, this, &ConfigWatcher::changed);
+
+    m_notifier = std::make_unique<QSocketNotifier>(m_fd, QSocketNotifier::Read);
+    connect(m_notifier.get(), &QSocketNotifier::activated, this, &ConfigWatcher::readEvents);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    m_notifier.reset();
+    close(m_fd);
+}
+
+/**
+ * Drains the inotify queue and restarts the settle timer if any event
+ * concerns the watched file.
+ */
+void ConfigWatcher::readEvents()
+{
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length{0};
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *p{buffer}; p < buffer + length;)
+        {
+            const auto *event{reinterpret_cast<const inotify_event *>(p)};
+            if (event->len > 0 && m_fileName == event->name)
+            {
+                m_settleTimer.start();
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+}
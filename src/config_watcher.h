@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>         // Signal on file change
+#include <QSocketNotifier> // inotify descriptor in the Qt event loop
+#include <QTimer>          // Debounce of bursts of events
+#include <memory>          // std::unique_ptr for the notifier
+#include <string>          // Watched path
+
+/**
+ * Watches a configuration file through inotify.
+ *
+ * The containing directory is watched rather than the file itself, because
+ * most editors save by writing a new file and renaming it over the old one,
+ * which would silently end a watch on the file's inode.
+ */
+class ConfigWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConfigWatcher(const std::string &path, QObject *parent = nullptr);
+    ~ConfigWatcher() override;
+
+signals:
+    // Emitted once a burst of writes to the file has settled
+    void changed();
+
+private:
+    void readEvents();
+
+    std::string m_fileName;
+    int m_fd{-1};
+    std::unique_ptr<QSocketNotifier> m_notifier;
+    QTimer m_settleTimer;
+};
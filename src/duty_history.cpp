@@ -0,0 +1,97 @@
+#include "duty_history.h"
+
+#include <algorithm> // std::min / std::max
+
+DutyHistory::DutyHistory(std::size_t sampleCapacity, std::int64_t windowUs, int bucketCount)
+    : m_samples(sampleCapacity), m_windowUs{windowUs}
+{
+    setBucketCount(bucketCount);
+}
+
+void DutyHistory::addSample(std::int64_t timeUs, std::uint8_t duty)
+{
+    m_samples[m_sampleHead] = Sample{timeUs, duty};
+    m_sampleHead = (m_sampleHead + 1) % m_samples.size();
+    m_sampleCount = std::min(m_sampleCount + 1, m_samples.size());
+
+    foldSample(timeUs, duty);
+}
+
+void DutyHistory::advanceTo(std::int64_t timeUs)
+{
+    if (m_hasSample)
+    {
+        openBucketsUpTo(timeUs / m_bucketUs);
+    }
+}
+
+void DutyHistory::setBucketCount(int bucketCount)
+{
+    m_buckets.assign(static_cast<std::size_t>(std::max(1, bucketCount)), Bucket{});
+    m_bucketUs = std::max<std::int64_t>(1, m_windowUs / static_cast<std::int64_t>(m_buckets.size()));
+    m_newestBucket = -1;
+    m_hasSample = false;
+
+    // Replay the raw ring, oldest first
+    const std::size_t oldest{(m_sampleHead + m_samples.size() - m_sampleCount) % m_samples.size()};
+    for (std::size_t i{0}; i < m_sampleCount; ++i)
+    {
+        const Sample &sample{m_samples[(oldest + i) % m_samples.size()]};
+        foldSample(sample.timeUs, sample.duty);
+    }
+}
+
+const DutyHistory::Bucket &DutyHistory::bucket(int i) const
+{
+    // The oldest bucket directly follows the newest one in the ring
+    const auto size{static_cast<std::int64_t>(m_buckets.size())};
+    const std::int64_t absolute{m_newestBucket - size + 1 + i};
+    return m_buckets[static_cast<std::size_t>(((absolute % size) + size) % size)];
+}
+
+/**
+ * Folds one sample into the min/max bucket that covers its timestamp.
+ */
+void DutyHistory::foldSample(std::int64_t timeUs, std::uint8_t duty)
+{
+    const std::int64_t target{std::max(timeUs / m_bucketUs, m_newestBucket)};
+    openBucketsUpTo(target);
+
+    Bucket &current{m_buckets[static_cast<std::size_t>(target % static_cast<std::int64_t>(m_buckets.size()))]};
+    if (!current.valid)
+    {
+        current = Bucket{duty, duty, true};
+    }
+    else
+    {
+        current.min = std::min(current.min, duty);
+        current.max = std::max(current.max, duty);
+    }
+
+    m_lastDuty = duty;
+    m_hasSample = true;
+}
+
+/**
+ * Starts every bucket between the newest one and bucket. Buckets that no
+ * sample falls into hold the last duty, since the output doesn't change
+ * between samples. At most one full ring is touched per call.
+ */
+void DutyHistory::openBucketsUpTo(std::int64_t bucket)
+{
+    const auto size{static_cast<std::int64_t>(m_buckets.size())};
+    if (m_newestBucket < 0)
+    {
+        m_newestBucket = bucket;
+        m_buckets[static_cast<std::size_t>(bucket % size)] = Bucket{};
+        return;
+    }
+
+    const std::int64_t first{std::max(m_newestBucket + 1, bucket - size + 1)};
+    for (std::int64_t b{first}; b <= bucket; ++b)
+    {
+        m_buckets[static_cast<std::size_t>(b % size)] =
+            m_hasSample ? Bucket{m_lastDuty, m_lastDuty, true} : Bucket{};
+    }
+    m_newestBucket = std::max(m_newestBucket, bucket);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // Fixed-width sample and time types
+#include <vector>  // Ring storage
+
+/**
+ * Duty history of one channel over a sliding time window.
+ *
+ * Raw samples go into a fixed-size ring. At the same time each sample is
+ * folded into a per-pixel min/max bucket, so a plot only ever walks
+ * bucketCount() entries no matter how many samples arrived. The raw ring is
+ * only replayed when the bucket count changes (i.e. the plot was resized).
+ */
+class DutyHistory
+{
+public:
+    struct Bucket
+    {
+        std::uint8_t min{0};
+        std::uint8_t max{0};
+        bool valid{false}; // false until the window reaches back this far
+    };
+
+    DutyHistory(std::size_t sampleCapacity, std::int64_t windowUs, int bucketCount);
+
+    // Adds a sample; timestamps are expected to be non-decreasing
+    void addSample(std::int64_t timeUs, std::uint8_t duty);
+
+    // Moves the window forward to timeUs, holding the last duty value
+    void advanceTo(std::int64_t timeUs);
+
+    // Changes the horizontal resolution and re-decimates the raw samples
+    void setBucketCount(int bucketCount);
+
+    int bucketCount() const { return static_cast<int>(m_buckets.size()); }
+
+    // Bucket i of the window, 0 being the oldest
+    const Bucket &bucket(int i) const;
+
+private:
+    struct Sample
+    {
+        std::int64_t timeUs;
+        std::uint8_t duty;
+    };
+
+    void foldSample(std::int64_t timeUs, std::uint8_t duty);
+    void openBucketsUpTo(std::int64_t bucket);
+
+    // Raw sample ring
+    std::vector<Sample> m_samples;
+    std::size_t m_sampleHead{0}; // Next slot to write
+    std::size_t m_sampleCount{0};
+
+    // Decimated min/max ring, indexed by absolute bucket number modulo size
+    std::vector<Bucket> m_buckets;
+    std::int64_t m_windowUs;
+    std::int64_t m_bucketUs{1};
+    std::int64_t m_newestBucket{-1}; // Absolute number of the newest bucket
+    std::uint8_t m_lastDuty{0};
+    bool m_hasSample{false};
+};
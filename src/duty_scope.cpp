@@ -0,0 +1,137 @@
+#include "duty_scope.h"
+
+#include <QPainter> // Trace drawing
+
+// Raw samples kept per channel; at 1 kHz this covers the last ~16 seconds
+constexpr std::size_t SAMPLE_CAPACITY{16384};
+constexpr int SCROLL_INTERVAL_MS{33}; // ~30 fps is plenty for a scrolling plot
+
+DutyScope::DutyScope(PwmEngine &engine, int windowSeconds, QWidget *parent)
+    : QWidget{parent}, m_engine{engine},
+      m_windowUs{static_cast<std::int64_t>(windowSeconds) * 1000000}
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    m_clock.start();
+    selectChannels();
+
+    m_listenerId = m_engine.addOutputListener([this](std::size_t channel)
+                                              { recordSample(channel); });
+    m_layoutListenerId = m_engine.addLayoutListener([this](bool done)
+                                                    {
+        if (done) {
+            selectChannels();
+        } });
+
+    m_scrollTimer.setInterval(SCROLL_INTERVAL_MS);
+    connect(&m_scrollTimer, &QTimer::timeout, this, &DutyScope::scroll);
+}
+
+DutyScope::~DutyScope()
+{
+    m_engine.removeOutputListener(m_listenerId);
+    m_engine.removeLayoutListener(m_layoutListenerId);
+}
+
+/**
+ * Starts a fresh trace for every channel that drives a real pin.
+ */
+void DutyScope::selectChannels()
+{
+    m_channels.clear();
+    m_traces.clear();
+    m_traceOf.assign(m_engine.channelCount(), -1);
+
+    for (std::size_t i{0}; i < m_engine.channelCount(); ++i)
+    {
+        if (m_engine.channel(i).gpioPin != NO_GPIO)
+        {
+            m_traceOf[i] = static_cast<int>(m_channels.size());
+            m_channels.push_back(i);
+            m_traces.emplace_back(SAMPLE_CAPACITY, m_windowUs, width());
+            recordSample(i); // Start each trace at the current duty
+        }
+    }
+}
+
+QSize DutyScope::sizeHint() const
+{
+    return QSize{400, 80};
+}
+
+void DutyScope::recordSample(std::size_t channel)
+{
+    if (channel >= m_traceOf.size() || m_traceOf[channel] < 0)
+    {
+        return;
+    }
+
+    // Traces are stored as 0–255 whatever the channel's PWM range
+    const Channel &state{m_engine.channel(channel)};
+    const auto duty{static_cast<std::uint8_t>(state.output * 255 / state.range)};
+    m_traces[static_cast<std::size_t>(m_traceOf[channel])].addSample(m_clock.nsecsElapsed() / 1000, duty);
+}
+
+/**
+ * Moves every trace to "now" so the plot keeps scrolling while duties
+ * are constant, then schedules a repaint.
+ */
+void DutyScope::scroll()
+{
+    const std::int64_t nowUs{m_clock.nsecsElapsed() / 1000};
+    for (DutyHistory &trace : m_traces)
+    {
+        trace.advanceTo(nowUs);
+    }
+    update();
+}
+
+void DutyScope::paintEvent(QPaintEvent *)
+{
+    QPainter painter{this};
+    painter.fillRect(rect(), Qt::black);
+
+    const int plotHeight{height() - 1};
+    for (std::size_t t{0}; t < m_traces.size(); ++t)
+    {
+        const DutyHistory &trace{m_traces[t]};
+
+        // One vertical min..max segment per pixel column
+        m_lines.clear();
+        for (int x{0}; x < trace.bucketCount(); ++x)
+        {
+            const DutyHistory::Bucket &bucket{trace.bucket(x)};
+            if (bucket.valid)
+            {
+                m_lines.append(QLine{x, plotHeight - bucket.max * plotHeight / 255,
+                                     x, plotHeight - bucket.min * plotHeight / 255});
+            }
+        }
+
+        const std::uint32_t color{m_engine.channel(m_channels[t]).color};
+        painter.setPen(QColor{static_cast<QRgb>(color)});
+        painter.drawLines(m_lines);
+    }
+}
+
+void DutyScope::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    for (DutyHistory &trace : m_traces)
+    {
+        trace.setBucketCount(width());
+    }
+}
+
+void DutyScope::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    m_scrollTimer.start();
+}
+
+void DutyScope::hideEvent(QHideEvent *event)
+{
+    // Samples are still recorded; only the repaints stop
+    m_scrollTimer.stop();
+    QWidget::hideEvent(event);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QElapsedTimer> // Monotonic timestamps for samples
+#include <QTimer>        // Scrolling refresh
+#include <QVector>       // Reused line buffer for drawing
+#include <QLine>
+#include <QWidget>       // Base class for the plot
+#include <vector>        // One history per plotted channel
+#include "duty_history.h"
+#include "pwm_engine.h"
+
+/**
+ * Scrolling oscilloscope of the outputs of every channel wired to a pin,
+ * over the last few seconds, used to diagnose flicker. Every output change
+ * is recorded as a sample; drawing walks one min/max bucket per pixel
+ * column, so it costs O(width) even when the engine updates at kHz rates.
+ */
+class DutyScope : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DutyScope(PwmEngine &engine, int windowSeconds = 10, QWidget *parent = nullptr);
+    ~DutyScope() override;
+
+    QSize sizeHint() const override;
+
+    void setScrollInterval(int ms) { m_scrollTimer.setInterval(ms); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void selectChannels();
+    void recordSample(std::size_t channel);
+    void scroll();
+
+    PwmEngine &m_engine;
+    PwmEngine::ListenerId m_listenerId{};
+    PwmEngine::ListenerId m_layoutListenerId{};
+    std::int64_t m_windowUs;
+    std::vector<std::size_t> m_channels; // Plotted engine channels (those with a pin)
+    std::vector<int> m_traceOf;          // Engine channel -> trace index, or -1
+    std::vector<DutyHistory> m_traces;
+
+    QElapsedTimer m_clock;
+    QTimer m_scrollTimer;
+    QVector<QLine> m_lines;
+};
@@ -0,0 +1,135 @@
+#include "effect_bench.h"
+
+#include <QElapsedTimer> // Frame timing
+#include <QtGlobal>      // qInfo
+#include <algorithm>     // std::size
+#include <cmath>         // std::sin for the hand-written baseline
+#include <memory>        // std::make_shared
+#include <string>        // Channel names
+#include <vector>        // Baseline output buffer
+#include "pwm_engine.h"
+
+// The formula of the "expression" run, and the same thing hand-written below
+constexpr const char *BENCH_EXPRESSION{"r/2 + r/2*sin(t*2 + i)"};
+
+static void printResult(const char *name, int channels, int frames, qint64 elapsedNs)
+{
+    const double frameUs{static_cast<double>(elapsedNs) / frames / 1000.0};
+    qInfo("%-10s %d channels: %.1f us/frame, %.1f ns/channel, %.2f M channel-frames/s",
+          name, channels, frameUs, frameUs * 1000.0 / channels,
+          static_cast<double>(channels) * frames * 1000.0 / static_cast<double>(elapsedNs));
+}
+
+/**
+ * BENCH_EXPRESSION compiled into the program, without the engine around
+ * it: the lower bound for the expression interpreter.
+ */
+static void runNativeBaseline(int channels, int frames)
+{
+    std::vector<int> levels(static_cast<std::size_t>(channels));
+    constexpr float RANGE{255.0f};
+    volatile int sink{0};
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame{0}; frame < frames; ++frame)
+    {
+        const float t{static_cast<float>(frame) * 0.02f};
+        for (int i{0}; i < channels; ++i)
+        {
+            const float value{RANGE / 2 + RANGE / 2 * std::sin(t * 2 + static_cast<float>(i))};
+            levels[static_cast<std::size_t>(i)] = static_cast<int>(value + 0.5f);
+        }
+        sink = sink + levels[static_cast<std::size_t>(frame % channels)];
+    }
+    printResult("native", channels, frames, timer.nsecsElapsed());
+}
+
+void runEffectBenchmark(int channels, int frames)
+{
+    struct Run
+    {
+        const char *name;
+        Pattern pattern;
+        const char *source; // Script name or expression text
+    };
+    static const Run RUNS[]{{"fade", Pattern::Fade, ""},
+                            {"flicker", Pattern::Flicker, ""},
+                            {"fire", Pattern::Fire, ""},
+                            {"twinkle", Pattern::Twinkle, ""},
+                            {"seesaw", Pattern::Script, "seesaw"}, // The fade as a coroutine
+                            {"expression", Pattern::Expression, BENCH_EXPRESSION}};
+
+    for (const Run &run : RUNS)
+    {
+        RigConfig config;
+        const auto expression{run.pattern == Pattern::Expression ? std::make_shared<const Expression>(run.source)
+                                                                 : nullptr};
+        for (int i{1}; i <= channels; ++i)
+        {
+            ChannelConfig channel{"Channel " + std::to_string(i)};
+            channel.pattern = run.pattern;
+            channel.script = run.pattern == Pattern::Script ? run.source : "";
+            channel.expression = expression;
+            config.channels.push_back(std::move(channel));
+        }
+
+        PwmEngine engine;
+        engine.setHardwareOutput(false);
+        engine.applyConfig(std::make_shared<const RigConfig>(std::move(config)));
+        engine.tick(); // Warm up: noise table, first compose
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int frame{0}; frame < frames; ++frame)
+        {
+            engine.tick();
+        }
+        printResult(run.name, channels, frames, timer.nsecsElapsed());
+    }
+
+    runNativeBaseline(channels, frames);
+}
+
+void runScalingBenchmark(int channels, int frames, int maxThreads)
+{
+    // Procedural patterns cost more per channel than the fade, so zones
+    // take different amounts of work and the pool has something to balance
+    static const Pattern PATTERNS[]{Pattern::Fade, Pattern::Flicker, Pattern::Fire, Pattern::Twinkle};
+    constexpr int ZONE_CHANNELS{200};
+
+    RigConfig config;
+    for (int i{0}; i < channels; ++i)
+    {
+        ChannelConfig channel{"Channel " + std::to_string(i + 1)};
+        const int zone{i / ZONE_CHANNELS};
+        channel.zone = "Zone " + std::to_string(zone + 1);
+        channel.pattern = PATTERNS[static_cast<std::size_t>(zone) % std::size(PATTERNS)];
+        config.channels.push_back(std::move(channel));
+    }
+    const auto shared{std::make_shared<const RigConfig>(std::move(config))};
+
+    double singleUs{0.0};
+    for (int threads{1}; threads <= maxThreads; ++threads)
+    {
+        PwmEngine engine;
+        engine.setHardwareOutput(false);
+        engine.setWorkerThreads(static_cast<std::size_t>(threads));
+        engine.applyConfig(shared);
+        engine.tick();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int frame{0}; frame < frames; ++frame)
+        {
+            engine.tick();
+        }
+        const double frameUs{static_cast<double>(timer.nsecsElapsed()) / frames / 1000.0};
+        if (threads == 1)
+        {
+            singleUs = frameUs;
+        }
+        qInfo("%d thread(s) %d channels: %.1f us/frame, speedup %.2fx",
+              threads, channels, frameUs, singleUs / frameUs);
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/**
+ * Times the engine frame with every channel running one pattern or script,
+ * for each pattern in turn, and prints the cost per frame and per channel.
+ * Runs without GPIO output, so it works on any machine.
+ */
+void runEffectBenchmark(int channels, int frames);
+
+/**
+ * Times a zoned rig of mixed patterns on 1 up to maxThreads threads and
+ * prints the frame cost and the speedup over the single-threaded engine.
+ */
+void runScalingBenchmark(int channels, int frames, int maxThreads);
@@ -0,0 +1,76 @@
+#include "effect_plugin.h"
+
+#include <cstdio>    // std::remove
+#include <dlfcn.h>   // dlopen, dlsym, dlclose
+#include <fstream>   // Copying the shared object
+#include <stdexcept> // std::runtime_error
+#include <unistd.h>  // mkstemps, close
+
+/**
+ * Copies path to a new temporary file and returns its name.
+ */
+static std::string privateCopy(const std::string &path)
+{
+    std::ifstream source{path, std::ios::binary};
+    if (!source)
+    {
+        throw std::runtime_error{"Cannot open plugin " + path};
+    }
+
+    char name[]{"/tmp/pwm-effect-XXXXXX.so"};
+    const int fd{mkstemps(name, 3)};
+    if (fd < 0)
+    {
+        throw std::runtime_error{"Cannot create a temporary copy of plugin " + path};
+    }
+    close(fd);
+
+    std::ofstream copy{name, std::ios::binary | std::ios::trunc};
+    copy << source.rdbuf();
+    if (!copy.flush())
+    {
+        std::remove(name);
+        throw std::runtime_error{"Cannot copy plugin " + path};
+    }
+    return name;
+}
+
+EffectPlugin::EffectPlugin(const std::string &path)
+    : m_path{path}
+{
+    const std::string copy{privateCopy(path)};
+    m_handle = dlopen(copy.c_str(), RTLD_NOW | RTLD_LOCAL);
+    std::remove(copy.c_str()); // The mapping stays valid; nothing is left behind
+    if (m_handle == nullptr)
+    {
+        throw std::runtime_error{"Cannot load plugin " + path + ": " + dlerror()};
+    }
+
+    const auto entryPoint{reinterpret_cast<PwmEffectEntryPoint>(dlsym(m_handle, PWM_EFFECT_ENTRY_POINT))};
+    m_api = entryPoint != nullptr ? entryPoint() : nullptr;
+
+    std::string problem;
+    if (m_api == nullptr)
+    {
+        problem = "no " PWM_EFFECT_ENTRY_POINT "()";
+    }
+    else if (m_api->apiVersion != PWM_EFFECT_API_VERSION)
+    {
+        problem = "built for API version " + std::to_string(m_api->apiVersion) + ", expected " +
+                  std::to_string(PWM_EFFECT_API_VERSION);
+    }
+    else if (m_api->init == nullptr || m_api->evaluate == nullptr || m_api->destroy == nullptr)
+    {
+        problem = "missing init, evaluate or destroy";
+    }
+    if (!problem.empty())
+    {
+        dlclose(m_handle);
+        throw std::runtime_error{"Plugin " + path + ": " + problem};
+    }
+}
+
+EffectPlugin::~EffectPlugin()
+{
+    dlclose(m_handle);
+}
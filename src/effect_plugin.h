@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string> // Plugin path
+#include "effect_plugin_api.h"
+
+/**
+ * An effect plugin loaded from a shared object (see effect_plugin_api.h).
+ *
+ * The file is copied to a private temporary file before dlopen(). The
+ * dynamic loader hands back the already loaded object for a path it has
+ * open, so without the copy a rebuilt plugin could only be loaded after the
+ * old one was closed. With it, the new version is loaded and checked while
+ * the old one keeps running. The engine swaps them between two frames.
+ */
+class EffectPlugin
+{
+public:
+    // Loads and checks the plugin; throws std::runtime_error if it is unusable
+    explicit EffectPlugin(const std::string &path);
+    ~EffectPlugin();
+
+    EffectPlugin(const EffectPlugin &) = delete;
+    EffectPlugin &operator=(const EffectPlugin &) = delete;
+
+    const std::string &path() const { return m_path; }
+    const PwmEffectPlugin &api() const { return *m_api; }
+
+private:
+    std::string m_path;
+    void *m_handle{nullptr};
+    const PwmEffectPlugin *m_api{nullptr};
+};
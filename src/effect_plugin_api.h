@@ -0,0 +1,52 @@
+/*
+ * The C interface between the engine and effect plugins. Plugins are
+ * shared objects built against this header only; it is plain C so that
+ * they can be written in C, C++ or anything else that can export a C
+ * symbol, and so that the ABI does not depend on the compiler version.
+ *
+ * Changing anything here that breaks existing plugins means bumping
+ * PWM_EFFECT_API_VERSION.
+ */
+#ifndef PWM_EFFECT_PLUGIN_API_H
+#define PWM_EFFECT_PLUGIN_API_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWM_EFFECT_API_VERSION 1
+
+/* One evaluation: every channel the plugin drives, for one frame */
+typedef struct PwmEffectBatch
+{
+    uint32_t count;        /* Channels in this batch */
+    const uint32_t *index; /* Rig index of each channel */
+    const int32_t *range;  /* Maximum duty of each channel */
+    double time;           /* Seconds of engine frames */
+    int32_t *out;          /* Level per channel, 0–range; clamped by the engine */
+} PwmEffectBatch;
+
+typedef struct PwmEffectPlugin
+{
+    uint32_t apiVersion; /* PWM_EFFECT_API_VERSION the plugin was built with */
+    const char *name;
+
+    /* Creates the state for channelCount channels; may return NULL if no state is needed */
+    void *(*init)(uint32_t channelCount, uint64_t seed);
+    /* Fills batch->out; called once per frame from the engine thread */
+    void (*evaluate)(void *state, const PwmEffectBatch *batch);
+    /* Frees what init returned */
+    void (*destroy)(void *state);
+} PwmEffectPlugin;
+
+/* Every plugin exports this function */
+#define PWM_EFFECT_ENTRY_POINT "pwm_effect_plugin"
+typedef const PwmEffectPlugin *(*PwmEffectEntryPoint)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,153 @@
+#include "effect_script.h"
+
+#include <new>     // operator new fallback for oversized frames
+#include <utility> // std::move
+
+void *FramePool::allocate(std::size_t size)
+{
+    const std::size_t sizeClass{(size + CLASS_SIZE - 1) / CLASS_SIZE - 1};
+    if (sizeClass >= CLASS_COUNT)
+    {
+        return ::operator new(size);
+    }
+
+    if (m_free[sizeClass] == nullptr)
+    {
+        // Carve a new slab into blocks of this class
+        const std::size_t blockSize{(sizeClass + 1) * CLASS_SIZE};
+        m_slabs.push_back(std::make_unique<std::byte[]>(blockSize * SLAB_BLOCKS));
+        std::byte *slab{m_slabs.back().get()};
+        for (std::size_t i{0}; i < SLAB_BLOCKS; ++i)
+        {
+            auto *block{reinterpret_cast<FreeBlock *>(slab + i * blockSize)};
+            block->next = m_free[sizeClass];
+            m_free[sizeClass] = block;
+        }
+    }
+
+    FreeBlock *block{m_free[sizeClass]};
+    m_free[sizeClass] = block->next;
+    return block;
+}
+
+void FramePool::deallocate(void *frame, std::size_t size)
+{
+    const std::size_t sizeClass{(size + CLASS_SIZE - 1) / CLASS_SIZE - 1};
+    if (sizeClass >= CLASS_COUNT)
+    {
+        ::operator delete(frame);
+        return;
+    }
+
+    auto *block{static_cast<FreeBlock *>(frame)};
+    block->next = m_free[sizeClass];
+    m_free[sizeClass] = block;
+}
+
+FramePool &effectFramePool()
+{
+    static FramePool pool;
+    return pool;
+}
+
+EffectTask &EffectTask::operator=(EffectTask &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+        m_handle = other.m_handle;
+        other.m_handle = {};
+    }
+    return *this;
+}
+
+EffectTask::~EffectTask()
+{
+    if (m_handle)
+    {
+        m_handle.destroy();
+    }
+}
+
+/**
+ * Reserves everything up front, so starting scripts later only takes a
+ * pooled frame.
+ */
+void EffectScheduler::reset(std::size_t channels, int frameIntervalMs)
+{
+    m_tasks.clear();
+    m_tasks.resize(channels);
+    m_contexts.assign(channels, EffectContext{});
+    for (EffectContext &context : m_contexts)
+    {
+        context.m_frameIntervalMs = frameIntervalMs;
+    }
+    m_generations.assign(channels, 0);
+    m_heap.clear();
+    m_heap.reserve(channels);
+    m_nextFrame.clear();
+    m_nextFrame.reserve(channels);
+    m_due.clear();
+    m_due.reserve(channels);
+    m_active = 0;
+}
+
+/**
+ * The script runs to its first co_await on the next advance().
+ */
+void EffectScheduler::start(std::size_t channel, EffectScript script, int range, int step, std::uint64_t seed)
+{
+    cancel(channel);
+
+    EffectContext &context{m_contexts[channel]};
+    context.m_range = range;
+    context.m_step = step;
+    context.m_rng = Pcg32{seed, channel};
+    context.m_value = 0;
+    context.m_changed = false;
+
+    m_tasks[channel] = script(context);
+    ++m_active;
+    schedule(channel, m_frame + 1);
+}
+
+void EffectScheduler::cancel(std::size_t channel)
+{
+    if (m_tasks[channel])
+    {
+        m_tasks[channel] = EffectTask{};
+        ++m_generations[channel]; // Its heap entry is skipped when it comes up
+        --m_active;
+    }
+}
+
+void EffectScheduler::schedule(std::size_t channel, std::uint64_t frame)
+{
+    if (frame == m_frame + 1)
+    {
+        m_nextFrame.push_back(Wake{frame, channel, m_generations[channel]});
+        return;
+    }
+    m_heap.push_back(Wake{frame, channel, m_generations[channel]});
+    std::push_heap(m_heap.begin(), m_heap.end(), [](const Wake &a, const Wake &b)
+                   { return a.frame > b.frame; });
+}
+
+/**
+ * Runs a script up to its next co_await and puts it back on the heap, or
+ * frees its frame if it returned.
+ */
+void EffectScheduler::resume(const Wake &wake)
+{
+    const EffectTask::Handle handle{m_tasks[wake.channel].handle()};
+    handle.resume();
+    if (handle.done())
+    {
+        cancel(wake.channel);
+        return;
+    }
+    schedule(wake.channel, m_frame + handle.promise().delayFrames);
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm> // std::push_heap, std::pop_heap
+#include <array>     // Free lists per size class
+#include <chrono>    // Waits given as durations
+#include <coroutine> // C++20 coroutines
+#include <cstddef>   // std::size_t
+#include <cstdint>   // Frame numbers
+#include <memory>    // Slab storage
+#include <vector>    // Tasks, contexts and the wake-up heap
+#include "procedural.h"
+
+/**
+ * Recycles coroutine frames. Frames are rounded up to a size class and
+ * carved from slabs; a freed frame goes onto its class's free list and is
+ * handed out again, so once the slabs are warm starting and finishing
+ * effects never touches the heap. Frames larger than the biggest class
+ * fall back to operator new. Used from the engine thread only.
+ */
+class FramePool
+{
+public:
+    static constexpr std::size_t CLASS_SIZE{64};
+    static constexpr std::size_t CLASS_COUNT{16}; // Classes up to 1 kB
+    static constexpr std::size_t SLAB_BLOCKS{64};
+
+    void *allocate(std::size_t size);
+    void deallocate(void *frame, std::size_t size);
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    std::array<FreeBlock *, CLASS_COUNT> m_free{};
+    std::vector<std::unique_ptr<std::byte[]>> m_slabs;
+};
+
+// The pool every effect coroutine frame comes from
+FramePool &effectFramePool();
+
+/**
+ * The return type of an effect script. Owns the coroutine; the script
+ * starts suspended and is first resumed by the scheduler.
+ */
+class EffectTask
+{
+public:
+    struct promise_type
+    {
+        std::uint32_t delayFrames{0}; // Set by the awaiter the script is suspended on
+
+        EffectTask get_return_object() { return EffectTask{Handle::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { throw; }
+
+        static void *operator new(std::size_t size) { return effectFramePool().allocate(size); }
+        static void operator delete(void *frame, std::size_t size) { effectFramePool().deallocate(frame, size); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    EffectTask() = default;
+    explicit EffectTask(Handle handle) : m_handle{handle} {}
+    EffectTask(EffectTask &&other) noexcept : m_handle{other.m_handle} { other.m_handle = {}; }
+    EffectTask &operator=(EffectTask &&other) noexcept;
+    EffectTask(const EffectTask &) = delete;
+    EffectTask &operator=(const EffectTask &) = delete;
+    ~EffectTask();
+
+    explicit operator bool() const { return static_cast<bool>(m_handle); }
+    Handle handle() const { return m_handle; }
+
+private:
+    Handle m_handle{};
+};
+
+// co_await'ed by scripts: suspends for a number of frames (at least one)
+struct FrameAwaiter
+{
+    std::uint32_t frames;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(EffectTask::Handle handle) const noexcept { handle.promise().delayFrames = frames; }
+    void await_resume() const noexcept {}
+};
+
+/**
+ * What a script sees of its channel: its range, a random generator, and a
+ * level it sets for the effects layer. The scheduler keeps one per channel
+ * at a fixed address for as long as the script runs.
+ */
+class EffectContext
+{
+public:
+    int range() const { return m_range; }
+    // The channel's configured step, for scripts that move by it each frame
+    int step() const { return m_step; }
+    Pcg32 &rng() { return m_rng; }
+
+    // The level is picked up by the engine after the script suspends
+    void set(int value)
+    {
+        m_value = value < 0 ? 0 : (value > m_range ? m_range : value);
+        m_changed = true;
+    }
+
+    FrameAwaiter nextFrame() const { return FrameAwaiter{1}; }
+    FrameAwaiter frames(int count) const { return FrameAwaiter{count > 1 ? static_cast<std::uint32_t>(count) : 1U}; }
+    FrameAwaiter wait(std::chrono::milliseconds time) const
+    {
+        return frames(static_cast<int>((time.count() + m_frameIntervalMs - 1) / m_frameIntervalMs));
+    }
+
+private:
+    friend class EffectScheduler;
+
+    int m_range{255};
+    int m_step{2};
+    int m_frameIntervalMs{20};
+    Pcg32 m_rng;
+    int m_value{0};
+    bool m_changed{false};
+};
+
+// An effect script: a coroutine taking its channel's context
+using EffectScript = EffectTask (*)(EffectContext &context);
+
+/**
+ * Runs one script per channel. Scripts waiting for the next frame, the
+ * common case, go on a plain list; longer sleeps sit in a min-heap keyed by
+ * the frame they wake on. A frame only touches the scripts that are due.
+ */
+class EffectScheduler
+{
+public:
+    // Drops every script and makes room for channels
+    void reset(std::size_t channels, int frameIntervalMs);
+
+    // Starts script on a channel, replacing any script already there
+    void start(std::size_t channel, EffectScript script, int range, int step, std::uint64_t seed);
+    void cancel(std::size_t channel);
+    // Changes the step a running script sees from its next resume on
+    void setStep(std::size_t channel, int step) { m_contexts[channel].m_step = step; }
+
+    /**
+     * Advances one frame and resumes every script that is due, calling
+     * changed(channel, level) for each one that set a new level.
+     */
+    template <typename Callback>
+    void advance(Callback &&changed);
+
+    std::size_t activeCount() const { return m_active; }
+
+private:
+    struct Wake
+    {
+        std::uint64_t frame;
+        std::size_t channel;
+        std::uint32_t generation; // Skips entries of cancelled scripts
+    };
+
+    void schedule(std::size_t channel, std::uint64_t frame);
+    void resume(const Wake &wake);
+    template <typename Callback>
+    void resumeDue(const Wake &wake, Callback &changed);
+
+    std::vector<EffectTask> m_tasks;
+    std::vector<EffectContext> m_contexts;
+    std::vector<std::uint32_t> m_generations;
+    std::vector<Wake> m_heap;
+    std::vector<Wake> m_nextFrame; // Due on the frame after the current one
+    std::vector<Wake> m_due;       // The list being resumed, swapped with m_nextFrame
+    std::uint64_t m_frame{0};
+    std::size_t m_active{0};
+};
+
+template <typename Callback>
+void EffectScheduler::advance(Callback &&changed)
+{
+    ++m_frame;
+    m_due.swap(m_nextFrame);
+    for (const Wake &wake : m_due)
+    {
+        resumeDue(wake, changed);
+    }
+    m_due.clear();
+
+    const auto later{[](const Wake &a, const Wake &b)
+                     { return a.frame > b.frame; }};
+    while (!m_heap.empty() && m_heap.front().frame <= m_frame)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), later);
+        const Wake wake{m_heap.back()};
+        m_heap.pop_back();
+        resumeDue(wake, changed);
+    }
+}
+
+template <typename Callback>
+void EffectScheduler::resumeDue(const Wake &wake, Callback &changed)
+{
+    if (wake.generation != m_generations[wake.channel])
+    {
+        return; // Cancelled or restarted since it was scheduled
+    }
+
+    resume(wake);
+    EffectContext &context{m_contexts[wake.channel]};
+    if (context.m_changed)
+    {
+        context.m_changed = false;
+        changed(wake.channel, context.m_value);
+    }
+}
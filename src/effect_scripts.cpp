@@ -0,0 +1,97 @@
+#include "effect_scripts.h"
+
+#include <chrono> // Waits in milliseconds
+
+using namespace std::chrono_literals;
+
+/**
+ * The original green/blue fade as a script: the position and direction
+ * that TimerState kept in flags are now just the loop variables. Like
+ * the fade it moves by the channel's step each frame.
+ */
+static EffectTask seesaw(EffectContext &context)
+{
+    for (;;)
+    {
+        for (int level{0}; level < context.range(); level += context.step())
+        {
+            context.set(level);
+            co_await context.nextFrame();
+        }
+        for (int level{context.range()}; level > 0; level -= context.step())
+        {
+            context.set(level);
+            co_await context.nextFrame();
+        }
+    }
+}
+
+// Slow in, hold, slow out, rest
+static EffectTask breathe(EffectContext &context)
+{
+    constexpr int STEPS{60};
+    for (;;)
+    {
+        for (int i{0}; i <= STEPS; ++i)
+        {
+            context.set(context.range() * i * i / (STEPS * STEPS));
+            co_await context.nextFrame();
+        }
+        co_await context.wait(400ms);
+        for (int i{STEPS}; i >= 0; --i)
+        {
+            context.set(context.range() * i * i / (STEPS * STEPS));
+            co_await context.nextFrame();
+        }
+        co_await context.wait(800ms);
+    }
+}
+
+// Two beats, then a pause
+static EffectTask heartbeat(EffectContext &context)
+{
+    for (;;)
+    {
+        context.set(context.range());
+        co_await context.wait(100ms);
+        context.set(0);
+        co_await context.wait(150ms);
+        context.set(context.range() * 7 / 10);
+        co_await context.wait(100ms);
+        context.set(0);
+        co_await context.wait(900ms);
+    }
+}
+
+// Short flashes at random intervals of 0.2–2 s
+static EffectTask sparkle(EffectContext &context)
+{
+    for (;;)
+    {
+        co_await context.wait(std::chrono::milliseconds{200 + context.rng().nextBelow(1800)});
+        context.set(context.range());
+        co_await context.nextFrame();
+        context.set(0);
+    }
+}
+
+EffectScript findEffectScript(const std::string &name)
+{
+    struct Entry
+    {
+        const char *name;
+        EffectScript script;
+    };
+    static const Entry SCRIPTS[]{{"seesaw", seesaw},
+                                 {"breathe", breathe},
+                                 {"heartbeat", heartbeat},
+                                 {"sparkle", sparkle}};
+    for (const Entry &entry : SCRIPTS)
+    {
+        if (name == entry.name)
+        {
+            return entry.script;
+        }
+    }
+    return nullptr;
+}
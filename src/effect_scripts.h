@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string> // Script names
+#include "effect_script.h"
+
+// Looks up a built-in effect script by name; nullptr if there is none
+EffectScript findEffectScript(const std::string &name);
@@ -0,0 +1,561 @@
+#include "expression.h"
+
+#include <cctype>    // Tokenizing
+#include <cmath>     // std::sin, std::cos, std::fmod, std::floor
+#include <cstdlib>   // strtod_l
+#include <cstring>   // std::memcmp
+#include <locale.h>  // newlocale
+#include <memory>    // std::unique_ptr syntax tree
+#include <stdexcept> // std::runtime_error
+#include "procedural.h"
+
+namespace
+{
+
+// Cells beyond this are folded to 0; anything up to it converts to long long
+constexpr double MAX_NOISE_CELL{4611686018427387904.0}; // 2^62
+
+/**
+ * The noise table entry for x. The cell is range checked before the
+ * integer conversion, so huge values, infinities and NaN give the entry
+ * of cell 0 instead of undefined behaviour.
+ */
+inline std::size_t noiseIndex(double x)
+{
+    const double cell{std::floor(x * NOISE_CELL_SIZE)};
+    const double safe{std::fabs(cell) < MAX_NOISE_CELL ? cell : 0.0}; // false for NaN
+    return static_cast<std::size_t>(static_cast<long long>(safe)) & (NOISE_TABLE_SIZE - 1);
+}
+
+// Applies one operation to scalars with libm; used for constant folding
+double apply(Expression::Op op, double a, double b)
+{
+    using Op = Expression::Op;
+    switch (op)
+    {
+    case Op::Add:
+        return a + b;
+    case Op::Sub:
+        return a - b;
+    case Op::Mul:
+        return a * b;
+    case Op::Div:
+        return a / b;
+    case Op::Mod:
+        return std::fmod(a, b);
+    case Op::Neg:
+        return -a;
+    case Op::Sin:
+        return std::sin(a);
+    case Op::Cos:
+        return std::cos(a);
+    case Op::Abs:
+        return std::fabs(a);
+    case Op::Floor:
+        return std::floor(a);
+    case Op::Min:
+        return a < b ? a : b;
+    case Op::Max:
+        return a > b ? a : b;
+    case Op::Noise:
+        return static_cast<double>(noiseTable()[noiseIndex(a)]) / PROCEDURAL_FULL;
+    }
+    return 0.0;
+}
+
+constexpr double PI{3.14159265358979323846};
+
+// Adding and subtracting 1.5 * 2^52 rounds a double to the nearest integer without a rounding instruction
+constexpr double ROUNDING_BIAS{6755399441055744.0};
+
+/**
+ * sin without libm, so the lane loops vectorize: x is reduced to [-π, π]
+ * by whole turns, folded onto [-π/2, π/2] with sin(π - r) = sin(r), and
+ * fed to the Taylor polynomial up to r^11 (error below 6e-8).
+ */
+inline double laneSin(double x)
+{
+    constexpr double HALF_PI{PI / 2};
+    const double turns{(x * (0.5 / PI) + ROUNDING_BIAS) - ROUNDING_BIAS};
+    double r{x - turns * (2 * PI)};
+    r = r > HALF_PI ? PI - r : r;
+    r = r < -HALF_PI ? -PI - r : r;
+    const double r2{r * r};
+    return r * (1.0 + r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 +
+                            r2 * (1.0 / 362880 + r2 * (-1.0 / 39916800))))));
+}
+
+struct Node
+{
+    enum class Kind
+    {
+        Constant,
+        Variable,
+        Operation
+    };
+
+    Kind kind;
+    double value{0.0};        // Constant
+    std::uint8_t variable{0}; // Variable: its register
+    Expression::Op op{Expression::Op::Add};
+    std::unique_ptr<Node> a;
+    std::unique_ptr<Node> b;
+};
+
+std::unique_ptr<Node> constant(double value)
+{
+    auto node{std::make_unique<Node>()};
+    node->kind = Node::Kind::Constant;
+    node->value = value;
+    return node;
+}
+
+/**
+ * Builds an operation node, or a constant if every operand is constant
+ * (noise reads a fixed table, so it folds as well).
+ */
+std::unique_ptr<Node> operation(Expression::Op op, std::unique_ptr<Node> a, std::unique_ptr<Node> b = {})
+{
+    const bool foldable{a->kind == Node::Kind::Constant && (!b || b->kind == Node::Kind::Constant)};
+    if (foldable)
+    {
+        return constant(apply(op, a->value, b ? b->value : 0.0));
+    }
+
+    auto node{std::make_unique<Node>()};
+    node->kind = Node::Kind::Operation;
+    node->op = op;
+    node->a = std::move(a);
+    node->b = std::move(b);
+    return node;
+}
+
+/**
+ * Recursive descent over:
+ *   sum     = product { ("+" | "-") product }
+ *   product = unary { ("*" | "/" | "%") unary }
+ *   unary   = "-" unary | primary
+ *   primary = number | variable | function "(" sum { "," sum } ")" | "(" sum ")"
+ */
+class Parser
+{
+public:
+    explicit Parser(const std::string &text) : m_text{text} {}
+
+    std::unique_ptr<Node> parse()
+    {
+        auto node{sum()};
+        skipSpace();
+        if (m_position != m_text.size())
+        {
+            fail("unexpected '" + std::string{1, m_text[m_position]} + "'");
+        }
+        return node;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string &message) const
+    {
+        throw std::runtime_error{"Expression \"" + m_text + "\" at " + std::to_string(m_position + 1) + ": " + message};
+    }
+
+    void skipSpace()
+    {
+        while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position])))
+        {
+            ++m_position;
+        }
+    }
+
+    bool accept(char c)
+    {
+        skipSpace();
+        if (m_position < m_text.size() && m_text[m_position] == c)
+        {
+            ++m_position;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if (!accept(c))
+        {
+            fail(std::string{"expected '"} + c + "'");
+        }
+    }
+
+    std::unique_ptr<Node> sum()
+    {
+        auto node{product()};
+        for (;;)
+        {
+            if (accept('+'))
+            {
+                node = operation(Expression::Op::Add, std::move(node), product());
+            }
+            else if (accept('-'))
+            {
+                node = operation(Expression::Op::Sub, std::move(node), product());
+            }
+            else
+            {
+                return node;
+            }
+        }
+    }
+
+    std::unique_ptr<Node> product()
+    {
+        auto node{unary()};
+        for (;;)
+        {
+            if (accept('*'))
+            {
+                node = operation(Expression::Op::Mul, std::move(node), unary());
+            }
+            else if (accept('/'))
+            {
+                node = operation(Expression::Op::Div, std::move(node), unary());
+            }
+            else if (accept('%'))
+            {
+                node = operation(Expression::Op::Mod, std::move(node), unary());
+            }
+            else
+            {
+                return node;
+            }
+        }
+    }
+
+    std::unique_ptr<Node> unary()
+    {
+        if (accept('-'))
+        {
+            return operation(Expression::Op::Neg, unary());
+        }
+        return primary();
+    }
+
+    std::unique_ptr<Node> primary()
+    {
+        skipSpace();
+        if (accept('('))
+        {
+            auto node{sum()};
+            expect(')');
+            return node;
+        }
+        if (m_position >= m_text.size())
+        {
+            fail("unexpected end");
+        }
+
+        const char c{m_text[m_position]};
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+        {
+            return constant(number());
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)))
+        {
+            const std::size_t start{m_position};
+            while (m_position < m_text.size() && std::isalnum(static_cast<unsigned char>(m_text[m_position])))
+            {
+                ++m_position;
+            }
+            return identifier(m_text.substr(start, m_position - start));
+        }
+        fail("unexpected '" + std::string{1, c} + "'");
+    }
+
+    /**
+     * Reads a number in the C locale: QApplication sets the user's, where
+     * "0.5" may not parse, before the config is loaded.
+     */
+    double number()
+    {
+        static const locale_t cLocale{newlocale(LC_ALL_MASK, "C", nullptr)};
+        const char *start{m_text.c_str() + m_position};
+        char *end{nullptr};
+        const double value{strtod_l(start, &end, cLocale)};
+        if (end == start)
+        {
+            fail("invalid number");
+        }
+        if (std::isinf(value))
+        {
+            fail("number out of range");
+        }
+        m_position += static_cast<std::size_t>(end - start);
+        return value;
+    }
+
+    std::unique_ptr<Node> identifier(const std::string &name)
+    {
+        static const struct
+        {
+            const char *name;
+            std::uint8_t reg;
+        } VARIABLES[]{{"t", Expression::REG_T}, {"i", Expression::REG_I}, {"r", Expression::REG_R}};
+        for (const auto &variable : VARIABLES)
+        {
+            if (name == variable.name)
+            {
+                auto node{std::make_unique<Node>()};
+                node->kind = Node::Kind::Variable;
+                node->variable = variable.reg;
+                return node;
+            }
+        }
+
+        static const struct
+        {
+            const char *name;
+            Expression::Op op;
+            int arguments;
+        } FUNCTIONS[]{{"sin", Expression::Op::Sin, 1},
+                      {"cos", Expression::Op::Cos, 1},
+                      {"abs", Expression::Op::Abs, 1},
+                      {"floor", Expression::Op::Floor, 1},
+                      {"noise", Expression::Op::Noise, 1},
+                      {"min", Expression::Op::Min, 2},
+                      {"max", Expression::Op::Max, 2}};
+        for (const auto &function : FUNCTIONS)
+        {
+            if (name == function.name)
+            {
+                expect('(');
+                auto a{sum()};
+                std::unique_ptr<Node> b;
+                if (function.arguments == 2)
+                {
+                    expect(',');
+                    b = sum();
+                }
+                expect(')');
+                return operation(function.op, std::move(a), std::move(b));
+            }
+        }
+        fail("unknown name \"" + name + "\"");
+    }
+
+    const std::string &m_text;
+    std::size_t m_position{0};
+};
+
+/**
+ * Compiles the folded tree. Constants are collected first, so the
+ * temporaries can be numbered right after them. Leaves are fixed registers
+ * and need no code; temporaries are handed out like a stack, so a
+ * subtree's temporaries are free again once its result is computed.
+ */
+class Compiler
+{
+public:
+    Compiler(const Node &tree, std::vector<double> &constants, std::vector<Expression::Instruction> &code)
+        : m_constants{constants}, m_code{code}
+    {
+        collectConstants(tree);
+        m_firstTemporary = Expression::FIRST_CONSTANT + m_constants.size();
+    }
+
+    std::uint8_t compile(const Node &node)
+    {
+        if (node.kind == Node::Kind::Variable)
+        {
+            return node.variable;
+        }
+        if (node.kind == Node::Kind::Constant)
+        {
+            return constantRegister(node.value);
+        }
+
+        const std::size_t mark{m_temporaries};
+        const std::uint8_t a{compile(*node.a)};
+        const std::uint8_t b{node.b ? compile(*node.b) : a};
+        m_temporaries = mark;
+        const std::uint8_t dst{temporary()};
+        m_code.push_back(Expression::Instruction{node.op, dst, a, b});
+        return dst;
+    }
+
+private:
+    void collectConstants(const Node &node)
+    {
+        if (node.kind == Node::Kind::Constant)
+        {
+            constantRegister(node.value);
+        }
+        if (node.a)
+        {
+            collectConstants(*node.a);
+        }
+        if (node.b)
+        {
+            collectConstants(*node.b);
+        }
+    }
+
+    // The register of a constant, adding it to the pool the first time. Bit patterns
+    // are compared, so a folded NaN (e.g. 0/0) finds its own entry again.
+    std::uint8_t constantRegister(double value)
+    {
+        std::size_t n{0};
+        while (n < m_constants.size() && std::memcmp(&m_constants[n], &value, sizeof value) != 0)
+        {
+            ++n;
+        }
+        if (n == m_constants.size())
+        {
+            m_constants.push_back(value);
+        }
+        return checkedRegister(Expression::FIRST_CONSTANT + n);
+    }
+
+    std::uint8_t temporary()
+    {
+        return checkedRegister(m_firstTemporary + m_temporaries++);
+    }
+
+    static std::uint8_t checkedRegister(std::size_t reg)
+    {
+        if (reg >= Expression::MAX_REGISTERS)
+        {
+            throw std::runtime_error{"Expression is too complex"};
+        }
+        return static_cast<std::uint8_t>(reg);
+    }
+
+    std::vector<double> &m_constants;
+    std::vector<Expression::Instruction> &m_code;
+    std::size_t m_firstTemporary{0};
+    std::size_t m_temporaries{0};
+};
+
+} // namespace
+
+Expression::Expression(const std::string &text)
+    : m_text{text}
+{
+    const std::unique_ptr<Node> tree{Parser{m_text}.parse()};
+    Compiler compiler{*tree, m_constants, m_code};
+    m_result = compiler.compile(*tree);
+}
+
+void Expression::evaluate(double t, const float *index, const float *range, std::size_t count, float *out) const
+{
+    alignas(64) double registers[MAX_REGISTERS][BATCH];
+    for (std::size_t k{0}; k < count; ++k)
+    {
+        registers[REG_T][k] = t;
+        registers[REG_I][k] = index[k];
+        registers[REG_R][k] = range[k];
+    }
+    for (std::size_t n{0}; n < m_constants.size(); ++n)
+    {
+        for (std::size_t k{0}; k < count; ++k)
+        {
+            registers[FIRST_CONSTANT + n][k] = m_constants[n];
+        }
+    }
+
+    // One dispatch per instruction; every op has its own lane loop, simple enough to vectorize
+    for (const Instruction &instruction : m_code)
+    {
+        double *dst{registers[instruction.dst]};
+        const double *a{registers[instruction.a]};
+        const double *b{registers[instruction.b]};
+        switch (instruction.op)
+        {
+        case Op::Add:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] + b[k];
+            }
+            break;
+        case Op::Sub:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] - b[k];
+            }
+            break;
+        case Op::Mul:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] * b[k];
+            }
+            break;
+        case Op::Div:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] / b[k];
+            }
+            break;
+        case Op::Min:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] < b[k] ? a[k] : b[k];
+            }
+            break;
+        case Op::Max:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] > b[k] ? a[k] : b[k];
+            }
+            break;
+        case Op::Mod:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = a[k] - b[k] * std::trunc(a[k] / b[k]); // fmod: the sign of a
+            }
+            break;
+        case Op::Neg:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = -a[k];
+            }
+            break;
+        case Op::Sin:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = laneSin(a[k]);
+            }
+            break;
+        case Op::Cos:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = laneSin(a[k] + PI / 2);
+            }
+            break;
+        case Op::Abs:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = std::fabs(a[k]);
+            }
+            break;
+        case Op::Floor:
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = std::floor(a[k]);
+            }
+            break;
+        case Op::Noise:
+        {
+            // A table lookup per lane; it gathers, but needs no dispatch or libm call
+            const std::uint16_t *table{noiseTable().data()};
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                dst[k] = static_cast<double>(table[noiseIndex(a[k])]) / PROCEDURAL_FULL;
+            }
+            break;
+        }
+        }
+    }
+
+    for (std::size_t k{0}; k < count; ++k)
+    {
+        out[k] = static_cast<float>(registers[m_result][k]);
+    }
+}
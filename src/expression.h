@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>   // Register file
+#include <cstddef> // std::size_t
+#include <cstdint> // Instruction fields
+#include <string>  // Source text
+#include <vector>  // Bytecode and constants
+
+/**
+ * A brightness formula such as "r/2 + r/2*sin(t*2 + i)", compiled once to
+ * register bytecode and evaluated for a whole batch of channels at a time.
+ *
+ * Variables: t (seconds of engine frames), i (channel index),
+ * r (channel range). Operators: + - * / % and unary minus. Functions: sin,
+ * cos, abs, floor, min, max and noise (the procedural noise table, 0–1,
+ * one lattice cell per unit).
+ *
+ * Every instruction works on a whole batch, so the dispatch cost is paid
+ * once per instruction and batch rather than once per channel. Constant
+ * subexpressions are folded at compile time, and variables and constants
+ * live in fixed registers, so they need no load instructions.
+ *
+ * Registers are doubles: t keeps counting across reloads and restarts, and
+ * as a float it would step coarser than a 20 ms frame after about 36 h.
+ */
+class Expression
+{
+public:
+    // Channels evaluated together
+    static constexpr std::size_t BATCH{64};
+    static constexpr std::size_t MAX_REGISTERS{32};
+
+    // Parses and compiles text; throws std::runtime_error on a syntax error
+    explicit Expression(const std::string &text);
+
+    /**
+     * Evaluates the formula for count (≤ BATCH) channels. index and range
+     * hold each channel's i and r; results go to out.
+     */
+    void evaluate(double t, const float *index, const float *range, std::size_t count, float *out) const;
+
+    const std::string &text() const { return m_text; }
+    std::size_t instructionCount() const { return m_code.size(); }
+
+    enum class Op : std::uint8_t
+    {
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Neg,
+        Sin,
+        Cos,
+        Abs,
+        Floor,
+        Min,
+        Max,
+        Noise
+    };
+
+    struct Instruction
+    {
+        Op op;
+        std::uint8_t dst;
+        std::uint8_t a;
+        std::uint8_t b;
+    };
+
+    // Fixed registers: the variables first, then the constants, then temporaries
+    static constexpr std::uint8_t REG_T{0};
+    static constexpr std::uint8_t REG_I{1};
+    static constexpr std::uint8_t REG_R{2};
+    static constexpr std::uint8_t FIRST_CONSTANT{3};
+
+private:
+    std::string m_text;
+    std::vector<double> m_constants; // Register FIRST_CONSTANT + n holds m_constants[n]
+    std::vector<Instruction> m_code;
+    std::uint8_t m_result{0};       // Register holding the result
+};
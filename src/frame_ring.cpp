@@ -0,0 +1,69 @@
+#include "frame_ring.h"
+
+#include <cstring>    // std::memset
+#include <fcntl.h>    // O_CREAT
+#include <stdexcept>  // std::runtime_error
+#include <sys/mman.h> // shm_open, mmap
+#include <unistd.h>   // ftruncate, close
+
+FrameRing::FrameRing(const std::string &name, std::size_t channels, std::size_t slots)
+    : m_name{name}
+{
+    if (channels == 0 || slots < 2)
+    {
+        throw std::runtime_error{"Frame ring " + name + " needs channels and at least two slots"};
+    }
+    // Slots start on 8-byte boundaries, so their sequence numbers are naturally aligned
+    const std::size_t slotBytes{(sizeof(FrameRingSlot) + channels * sizeof(std::uint16_t) + 7) / 8 * 8};
+    m_bytes = sizeof(FrameRingHeader) + slots * slotBytes;
+
+    // A stale object of a crashed engine may have another size or a producer mid-frame
+    shm_unlink(name.c_str());
+    const int fd{shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660)};
+    if (fd < 0)
+    {
+        throw std::runtime_error{"Cannot create shared memory " + name};
+    }
+    void *memory{ftruncate(fd, static_cast<off_t>(m_bytes)) == 0
+                     ? mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                     : MAP_FAILED};
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        throw std::runtime_error{"Cannot map shared memory " + name};
+    }
+
+    std::memset(memory, 0, m_bytes);
+    m_header = static_cast<FrameRingHeader *>(memory);
+    m_header->version = FRAME_RING_VERSION;
+    m_header->slotCount = static_cast<std::uint32_t>(slots);
+    m_header->channelCount = static_cast<std::uint32_t>(channels);
+    m_header->slotBytes = static_cast<std::uint32_t>(slotBytes);
+    m_staging.resize(channels);
+    // Written last: producers that find the magic find a complete header
+    __atomic_store_n(&m_header->magic, FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+}
+
+FrameRing::~FrameRing()
+{
+    // Tells attached producers that frames go nowhere now
+    __atomic_store_n(&m_header->magic, 0u, __ATOMIC_RELEASE);
+    munmap(m_header, m_bytes);
+    shm_unlink(m_name.c_str());
+}
+
+bool FrameRing::wait(std::chrono::microseconds timeout)
+{
+    // Read before checking for frames: a publish in between changes it, so the futex returns at once
+    const std::uint32_t wake{__atomic_load_n(&m_header->wake, __ATOMIC_ACQUIRE)};
+    if (published() != m_consumed)
+    {
+        return true;
+    }
+    const auto seconds{std::chrono::duration_cast<std::chrono::seconds>(timeout)};
+    const timespec relative{static_cast<time_t>(seconds.count()),
+                            static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds).count())};
+    syscall(SYS_futex, &m_header->wake, FUTEX_WAIT, wake, &relative, nullptr, 0);
+    return published() != m_consumed;
+}
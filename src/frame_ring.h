@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <atomic>    // Fences of the sequence lock
+#include <chrono>    // Wait timeout
+#include <cstddef>   // std::size_t
+#include <cstdint>   // Frame numbers and levels
+#include <cstring>   // std::memcpy into the staging buffer
+#include <string>    // Object name
+#include <vector>    // Staging buffer
+#include "frame_ring_layout.h"
+
+// Frames taken from a ring since it was created
+struct FrameRingStats
+{
+    std::size_t frames{0};  // Frames applied
+    std::size_t skipped{0}; // Published frames that were overtaken before they were read
+    std::size_t torn{0};    // Reads that raced the producer and were retried
+};
+
+/**
+ * The engine's end of a shared-memory frame ring (see frame_ring_layout.h
+ * for the layout and the producer side). Creates the object, and removes
+ * it again when destroyed.
+ *
+ * consume() copies the newest frame out of shared memory into a staging
+ * buffer and hands it to the caller only once the slot's sequence number
+ * shows the producer did not overtake the copy; a torn copy is repeated
+ * with the newer frame and never reaches the caller.
+ */
+class FrameRing
+{
+public:
+    // Creates the shared-memory object; throws std::runtime_error on failure
+    FrameRing(const std::string &name, std::size_t channels, std::size_t slots);
+    ~FrameRing();
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    // Calls apply(levels, count) with the newest complete frame, if one was
+    // published since the last call; true if it was applied
+    template <typename Apply>
+    bool consume(Apply &&apply);
+
+    // Sleeps until a frame is published or timeout passes; true if there is an unread frame
+    bool wait(std::chrono::microseconds timeout);
+
+    // Hands the newest frame to the next consume() again, e.g. after the channel list was rebuilt
+    void replay() { m_consumed = m_consumed > 0 ? m_consumed - 1 : 0; }
+
+    // Producer end, for tests and for producers in this process
+    FrameRingHeader *header() const { return m_header; }
+
+    const std::string &name() const { return m_name; }
+    std::size_t channelCount() const { return m_header->channelCount; }
+    // CLOCK_MONOTONIC time at which the last consumed frame was published
+    std::uint64_t lastTimestampNs() const { return m_lastTimestamp; }
+    const FrameRingStats &stats() const { return m_stats; }
+
+private:
+    std::uint64_t published() const { return __atomic_load_n(&m_header->published, __ATOMIC_ACQUIRE); }
+
+    std::string m_name;
+    FrameRingHeader *m_header{nullptr};
+    std::size_t m_bytes{0};
+    std::uint64_t m_consumed{0}; // Newest frame applied
+    std::uint64_t m_lastTimestamp{0};
+    std::vector<std::uint16_t> m_staging; // Levels of the frame being read, one per channel
+    FrameRingStats m_stats;
+};
+
+template <typename Apply>
+bool FrameRing::consume(Apply &&apply)
+{
+    // Bounded, so a producer that hangs in the middle of a frame cannot stall the engine
+    constexpr int MAX_READ_ATTEMPTS{4};
+    for (int attempt{0}; attempt < MAX_READ_ATTEMPTS; ++attempt)
+    {
+        const std::uint64_t frame{published()};
+        if (frame == 0 || frame == m_consumed)
+        {
+            return false;
+        }
+
+        const FrameRingSlot *slot{frame_ring_slot(m_header, frame)};
+        const std::uint64_t sequence{__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE)};
+        if (sequence != 2 * frame)
+        {
+            ++m_stats.torn; // Already being overwritten by a newer frame
+            continue;
+        }
+        const std::uint64_t timestamp{slot->timestampNs};
+        const std::size_t count{std::min<std::size_t>(slot->count, m_staging.size())};
+        std::memcpy(m_staging.data(), slot->levels, count * sizeof(std::uint16_t));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence)
+        {
+            ++m_stats.torn;
+            continue;
+        }
+        apply(m_staging.data(), count);
+
+        m_stats.skipped += frame - m_consumed - 1;
+        ++m_stats.frames;
+        m_consumed = frame;
+        m_lastTimestamp = timestamp;
+        __atomic_store_n(&m_header->consumed, frame, __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+}
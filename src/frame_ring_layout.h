@@ -0,0 +1,144 @@
+/*
+ * Layout of the shared-memory frame ring through which other processes
+ * feed frames to the engine (see frame_ring.h), and the producer side.
+ * Plain C, so a show computer's software can include it as it is.
+ *
+ * The engine creates the object (shm_open, default name "/pwm-frames"):
+ *
+ *   FrameRingHeader         64 bytes
+ *   slot 0 .. slotCount-1   slotBytes each: FrameRingSlot + channelCount levels
+ *
+ * Levels are 0–65535 per channel, in the engine's channel order; a frame
+ * may carry fewer than channelCount. Frame n (counting from 1) goes into
+ * slot (n - 1) % slotCount. There is one producer.
+ *
+ * Every slot is a sequence lock: the producer sets sequence to 2n - 1
+ * before writing frame n and to 2n after it. A reader that sees the same
+ * even value before and after copying got a whole frame. Then published
+ * is set to n and the wake counter is bumped; consumers sleep on it as a
+ * futex. The engine takes the newest frame each engine frame and skips
+ * any it missed; consumed tells the producer how far it got.
+ *
+ * A producer attaches with frame_ring_attach(), then for every frame
+ * calls frame_ring_begin(), fills in the levels and calls
+ * frame_ring_publish(). The engine clears magic when it quits; a producer
+ * that sees it cleared detaches and attaches again once the engine is back.
+ */
+#ifndef PWM_FRAME_RING_LAYOUT_H
+#define PWM_FRAME_RING_LAYOUT_H
+
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_RING_MAGIC 0x524D5750u /* "PWMR" */
+#define FRAME_RING_VERSION 1
+#define FRAME_RING_DEFAULT_NAME "/pwm-frames"
+
+typedef struct FrameRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t channelCount; /* Levels a slot has room for */
+    uint32_t slotBytes;    /* Distance between two slots */
+    uint32_t wake;         /* Futex word, bumped after every frame */
+    uint64_t published;    /* Frames published so far */
+    uint64_t consumed;     /* Newest frame the engine has taken */
+    uint8_t reserved[24];
+} FrameRingHeader;
+
+typedef struct FrameRingSlot
+{
+    uint64_t sequence;    /* 2n - 1 while frame n is written, 2n once it is complete */
+    uint64_t timestampNs; /* CLOCK_MONOTONIC when the producer finished the frame */
+    uint32_t count;       /* Levels in this frame */
+    uint32_t reserved;
+    uint16_t levels[];
+} FrameRingSlot;
+
+static inline FrameRingSlot *frame_ring_slot(FrameRingHeader *ring, uint64_t frame)
+{
+    return (FrameRingSlot *)((uint8_t *)ring + sizeof(FrameRingHeader) +
+                             (size_t)((frame - 1) % ring->slotCount) * ring->slotBytes);
+}
+
+/* Maps the ring the engine created; NULL if there is none or it has another version */
+static inline FrameRingHeader *frame_ring_attach(const char *name)
+{
+    const int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    void *memory = fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(FrameRingHeader)
+                       ? mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return NULL;
+    }
+    FrameRingHeader *ring = (FrameRingHeader *)memory;
+    if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != FRAME_RING_MAGIC || ring->version != FRAME_RING_VERSION ||
+        sizeof(FrameRingHeader) + (size_t)ring->slotCount * ring->slotBytes > (size_t)info.st_size)
+    {
+        munmap(memory, (size_t)info.st_size);
+        return NULL;
+    }
+    return ring;
+}
+
+static inline void frame_ring_detach(FrameRingHeader *ring)
+{
+    munmap(ring, sizeof(FrameRingHeader) + (size_t)ring->slotCount * ring->slotBytes);
+}
+
+/* False once the engine that created the ring has quit */
+static inline int frame_ring_valid(const FrameRingHeader *ring)
+{
+    return __atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) == FRAME_RING_MAGIC;
+}
+
+/* Starts the next frame; write up to channelCount levels into the result */
+static inline uint16_t *frame_ring_begin(FrameRingHeader *ring)
+{
+    const uint64_t frame = __atomic_load_n(&ring->published, __ATOMIC_RELAXED) + 1;
+    FrameRingSlot *slot = frame_ring_slot(ring, frame);
+    __atomic_store_n(&slot->sequence, 2 * frame - 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); /* Odd sequence before any level */
+    return slot->levels;
+}
+
+/* Completes the frame started by frame_ring_begin() with count levels and wakes the consumers */
+static inline void frame_ring_publish(FrameRingHeader *ring, uint32_t count)
+{
+    const uint64_t frame = __atomic_load_n(&ring->published, __ATOMIC_RELAXED) + 1;
+    FrameRingSlot *slot = frame_ring_slot(ring, frame);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    slot->timestampNs = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+    slot->count = count < ring->channelCount ? count : ring->channelCount;
+    __atomic_store_n(&slot->sequence, 2 * frame, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->published, frame, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&ring->wake, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &ring->wake, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#include "group_panel.h"
+
+#include <QHBoxLayout> // Label + slider rows
+#include <QLabel>      // Group names
+#include <QPalette>    // White label text
+#include <QSlider>     // Fader
+#include <QVBoxLayout> // Stack of rows
+
+GroupPanel::GroupPanel(PwmEngine &engine, QWidget *parent)
+    : QWidget{parent}, m_engine{engine}
+{
+    setLayout(new QVBoxLayout{});
+    layout()->setContentsMargins(0, 0, 0, 0);
+    rebuild();
+
+    m_layoutListenerId = m_engine.addLayoutListener([this](bool done)
+                                                    {
+        if (done) {
+            rebuild();
+        } });
+}
+
+GroupPanel::~GroupPanel()
+{
+    m_engine.removeLayoutListener(m_layoutListenerId);
+}
+
+void GroupPanel::rebuild()
+{
+    // Drop the rows of the previous config
+    while (QLayoutItem *item{layout()->takeAt(0)})
+    {
+        delete item->widget();
+        delete item;
+    }
+
+    for (std::size_t i{0}; i < m_engine.groupCount(); ++i)
+    {
+        const Group &group{m_engine.group(i)};
+
+        auto *label{new QLabel{QString::fromStdString(group.name)}};
+        label->setFont(QFont{"Arial", 11});
+        QPalette palette{label->palette()};
+        palette.setColor(QPalette::WindowText, Qt::white);
+        label->setPalette(palette);
+        label->setFixedWidth(104);
+
+        auto *slider{new QSlider{Qt::Horizontal}};
+        slider->setRange(0, 255);
+        slider->setValue(group.level);
+
+        // Only the channels below this fader are recomputed on the next frame
+        connect(slider, &QSlider::valueChanged, this, [this, i](int value)
+                { m_engine.setGroupLevel(i, value); });
+
+        auto *row{new QWidget{}};
+        auto *rowLayout{new QHBoxLayout{row}};
+        rowLayout->setContentsMargins(6, 0, 6, 0);
+        rowLayout->addWidget(label);
+        rowLayout->addWidget(slider);
+        layout()->addWidget(row);
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QWidget> // Base class for the fader panel
+#include "pwm_engine.h"
+
+/**
+ * One labelled slider per group fader: the master first, then each zone.
+ * There are only ever a handful of groups, so these are plain QSliders.
+ * The panel is rebuilt when a config reload changes the zones.
+ */
+class GroupPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit GroupPanel(PwmEngine &engine, QWidget *parent = nullptr);
+    ~GroupPanel() override;
+
+private:
+    void rebuild();
+
+    PwmEngine &m_engine;
+    PwmEngine::ListenerId m_layoutListenerId{};
+};
@@ -0,0 +1,41 @@
+#include "kiosk.h"
+
+#include <QtGlobal> // qputenv / qEnvironmentVariableIsEmpty
+#include <cstring>  // std::strcmp
+
+bool kioskRequested(int argc, char *argv[])
+{
+    for (int i{1}; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--kiosk") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Sets a variable only if the user hasn't already chosen a value.
+ */
+static void setDefaultEnv(const char *name, const char *value)
+{
+    if (qEnvironmentVariableIsEmpty(name))
+    {
+        qputenv(name, value);
+    }
+}
+
+void configureKioskPlatform()
+{
+    // linuxfb works on every Pi; set QT_QPA_PLATFORM=eglfs for GPU rendering
+    setDefaultEnv("QT_QPA_PLATFORM", "linuxfb");
+
+    // Use the evdev handlers directly instead of going through libinput
+    setDefaultEnv("QT_QPA_FB_NO_LIBINPUT", "1");
+    setDefaultEnv("QT_QPA_EGLFS_NO_LIBINPUT", "1");
+
+    // Touch screen only, so there is no mouse cursor to draw
+    setDefaultEnv("QT_QPA_FB_HIDECURSOR", "1");
+    setDefaultEnv("QT_QPA_EGLFS_HIDECURSOR", "1");
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/**
+ * Kiosk mode for panel-mounted units: the GUI runs full screen straight on
+ * the framebuffer (linuxfb) or GPU (eglfs) without an X server, and reads
+ * the touch screen through Qt's evdev input handlers.
+ */
+
+// true if --kiosk was passed on the command line
+bool kioskRequested(int argc, char *argv[]);
+
+// Sets the Qt platform environment for kiosk mode. Must run before the
+// QApplication is constructed. Variables already set by the user win.
+void configureKioskPlatform();
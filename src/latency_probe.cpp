@@ -0,0 +1,109 @@
+#include "latency_probe.h"
+
+#include <QAbstractItemView> // Target of the synthetic presses
+#include <QCoreApplication>  // Event posting and quitting
+#include <QMouseEvent>       // Synthetic press/release
+#include <algorithm>         // std::sort
+
+// Pause between presses so each sample starts from an idle event loop
+constexpr int SAMPLE_GAP_MS{10};
+// A press whose output has not changed by then is counted as a miss
+constexpr int SAMPLE_TIMEOUT_MS{1000};
+
+LatencyProbe::LatencyProbe(QAbstractItemView &view, PwmEngine &engine, std::size_t channel,
+                           int samples, QObject *parent)
+    : QObject{parent}, m_view{view}, m_engine{engine}, m_channel{channel}, m_samples{samples}
+{
+    m_latenciesNs.reserve(static_cast<std::size_t>(samples));
+    m_listenerId = m_engine.addOutputListener([this](std::size_t changed)
+                                              { onOutputChanged(changed); });
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(SAMPLE_TIMEOUT_MS);
+    connect(&m_timeout, &QTimer::timeout, this, &LatencyProbe::onTimeout);
+}
+
+LatencyProbe::~LatencyProbe()
+{
+    m_engine.removeOutputListener(m_listenerId);
+}
+
+void LatencyProbe::start()
+{
+    QTimer::singleShot(0, this, &LatencyProbe::sendPress);
+}
+
+/**
+ * Presses near the middle of the slider when the duty is in its upper
+ * half and near the end otherwise, so every press asks for a new duty,
+ * whatever the channel started from.
+ */
+void LatencyProbe::sendPress()
+{
+    const Channel &channel{m_engine.channel(m_channel)};
+    const QRect row{m_view.visualRect(m_view.model()->index(static_cast<int>(m_channel), 0))};
+    const double fraction{channel.duty * 2 >= channel.range ? 0.55 : 0.85};
+    const QPoint pos{row.left() + static_cast<int>(row.width() * fraction), row.center().y()};
+
+    QWidget *target{m_view.viewport()};
+    ++m_sent;
+    m_waiting = true;
+    m_timer.start();
+    m_timeout.start();
+    QCoreApplication::postEvent(target, new QMouseEvent{QEvent::MouseButtonPress, pos,
+                                                        Qt::LeftButton, Qt::LeftButton, Qt::NoModifier});
+    QCoreApplication::postEvent(target, new QMouseEvent{QEvent::MouseButtonRelease, pos,
+                                                        Qt::LeftButton, Qt::NoButton, Qt::NoModifier});
+}
+
+void LatencyProbe::onOutputChanged(std::size_t channel)
+{
+    if (!m_waiting || channel != m_channel)
+    {
+        return;
+    }
+
+    m_latenciesNs.push_back(m_timer.nsecsElapsed());
+    m_waiting = false;
+    m_timeout.stop();
+    nextSample();
+}
+
+void LatencyProbe::onTimeout()
+{
+    m_waiting = false;
+    ++m_misses;
+    nextSample();
+}
+
+void LatencyProbe::nextSample()
+{
+    if (m_sent < m_samples)
+    {
+        QTimer::singleShot(SAMPLE_GAP_MS, this, &LatencyProbe::sendPress);
+    }
+    else
+    {
+        report();
+        QCoreApplication::quit();
+    }
+}
+
+void LatencyProbe::report()
+{
+    if (m_misses > 0)
+    {
+        qWarning("%d of %d presses did not change the output within %d ms", m_misses, m_sent, SAMPLE_TIMEOUT_MS);
+    }
+    if (m_latenciesNs.empty())
+    {
+        return;
+    }
+
+    std::vector<qint64> sorted{m_latenciesNs};
+    std::sort(sorted.begin(), sorted.end());
+
+    const auto at{[&sorted](double q)
+                  { return sorted[static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1))] / 1000.0; }};
+    qInfo("Input-to-pin latency over %zu presses: min %.1f us, median %.1f us, p99 %.1f us, max %.1f us",
+          sorted.size(), at(0.0), at(0.5), at(0.99), at(1.0));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QElapsedTimer> // Input-to-output timing
+#include <QObject>       // Event loop driven probe
+#include <QTimer>        // Per-sample timeout
+#include <vector>        // Collected latencies
+#include "pwm_engine.h"
+
+class QAbstractItemView;
+
+/**
+ * Measures input-to-pin latency without a person at the screen.
+ *
+ * Posts synthetic presses onto the slider of one channel and times how long
+ * it takes until the engine writes the new output to the pin. The events go
+ * through the normal Qt event queue, view, delegate and the engine frame,
+ * so the figure covers everything inside the process. It works on any
+ * platform, including offscreen.
+ *
+ * A press that does not reach the pin within a second (master at 0,
+ * blackout, a press the view swallowed) counts as a miss and the probe
+ * moves on, so it always finishes.
+ */
+class LatencyProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    LatencyProbe(QAbstractItemView &view, PwmEngine &engine, std::size_t channel,
+                 int samples, QObject *parent = nullptr);
+    ~LatencyProbe() override;
+
+    // Starts probing; the application quits after the report is printed
+    void start();
+
+private:
+    void sendPress();
+    void onOutputChanged(std::size_t channel);
+    void onTimeout();
+    void nextSample();
+    void report();
+
+    QAbstractItemView &m_view;
+    PwmEngine &m_engine;
+    PwmEngine::ListenerId m_listenerId{};
+    std::size_t m_channel;
+    int m_samples;
+
+    QElapsedTimer m_timer;
+    QTimer m_timeout;
+    bool m_waiting{false};
+    int m_sent{0};
+    int m_misses{0};
+    std::vector<qint64> m_latenciesNs;
+};
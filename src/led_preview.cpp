@@ -0,0 +1,170 @@
+#include "led_preview.h"
+
+#include <QGuiApplication> // Primary screen for the refresh rate
+#include <QPaintEvent>     // Exposed region of partial repaints
+#include <QPainter>        // Tile drawing
+#include <QScreen>         // Display refresh rate
+#include <algorithm>       // std::max, std::clamp
+#include <cmath>           // std::lround
+
+// Square tile per channel, with a small gap between tiles
+constexpr int TILE_SIZE{18};
+constexpr int TILE_GAP{3};
+constexpr int TILE_PITCH{TILE_SIZE + TILE_GAP};
+// The preview asks for at most this many rows of full-size tiles
+constexpr int MAX_ROWS{8};
+// Smallest tile spacing, one pixel of tile and one of gap
+constexpr int MIN_PITCH{2};
+
+// Rows needed for count tiles at a given spacing
+static int rowsFor(std::size_t count, int width, int pitch)
+{
+    const int columns{std::max(1, width / pitch)};
+    return static_cast<int>((count + static_cast<std::size_t>(columns) - 1) / static_cast<std::size_t>(columns));
+}
+
+LedPreview::LedPreview(PwmEngine &engine, QWidget *parent)
+    : QWidget{parent}, m_engine{engine}
+{
+    // The cached image covers the whole widget, so Qt doesn't need to erase first
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    // Sample no faster than the display can show the result
+    const QScreen *screen{QGuiApplication::primaryScreen()};
+    const qreal refreshRate{screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0};
+    m_refreshTimer.setInterval(static_cast<int>(std::lround(1000.0 / refreshRate)));
+    m_refreshTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &LedPreview::refresh);
+
+    // Names, colors and ranges may all change on a config reload
+    m_layoutListenerId = m_engine.addLayoutListener([this](bool done)
+                                                    {
+        if (done) {
+            updateGeometry(); // The channel count sets the height
+            rebuildImage();
+        } });
+}
+
+LedPreview::~LedPreview()
+{
+    m_engine.removeLayoutListener(m_layoutListenerId);
+}
+
+QSize LedPreview::sizeHint() const
+{
+    return QSize{400, heightForWidth(400)};
+}
+
+/**
+ * Full-size tiles for every channel, but no more than MAX_ROWS of them.
+ */
+int LedPreview::heightForWidth(int width) const
+{
+    const int rows{rowsFor(m_engine.channelCount(), width - TILE_GAP, TILE_PITCH)};
+    return std::clamp(rows, 1, MAX_ROWS) * TILE_PITCH + TILE_GAP;
+}
+
+QRect LedPreview::tileRect(std::size_t index) const
+{
+    const int i{static_cast<int>(index)};
+    const int gap{m_pitch - m_tile};
+    return QRect{gap + (i % m_columns) * m_pitch,
+                 gap + (i / m_columns) * m_pitch,
+                 m_tile, m_tile};
+}
+
+/**
+ * Paints one tile: the channel color scaled by its duty cycle.
+ */
+void LedPreview::drawTile(QPainter &painter, std::size_t index) const
+{
+    const Channel &channel{m_engine.channel(index)};
+    const std::uint32_t color{channel.color};
+    const int duty{m_drawnDuty[index]};
+    const QColor lit{static_cast<int>((color >> 16) & 0xFF) * duty / channel.range,
+                     static_cast<int>((color >> 8) & 0xFF) * duty / channel.range,
+                     static_cast<int>(color & 0xFF) * duty / channel.range};
+
+    painter.fillRect(tileRect(index), lit);
+}
+
+/**
+ * Redraws the whole cached image, e.g. after a resize. The tiles get the
+ * largest spacing at which every channel fits the widget.
+ */
+void LedPreview::rebuildImage()
+{
+    m_image = QImage{size(), QImage::Format_RGB32};
+    m_image.fill(Qt::black);
+
+    m_engine.snapshotOutputs(m_drawnDuty);
+    m_pitch = TILE_PITCH;
+    while (m_pitch > MIN_PITCH)
+    {
+        const int gap{m_pitch - m_pitch * TILE_SIZE / TILE_PITCH};
+        if (rowsFor(m_drawnDuty.size(), width() - gap, m_pitch) * m_pitch + gap <= height())
+        {
+            break;
+        }
+        --m_pitch;
+    }
+    m_tile = std::max(1, m_pitch * TILE_SIZE / TILE_PITCH);
+    m_columns = std::max(1, (width() - (m_pitch - m_tile)) / m_pitch);
+
+    QPainter painter{&m_image};
+    for (std::size_t i{0}; i < m_drawnDuty.size(); ++i)
+    {
+        drawTile(painter, i);
+    }
+    update();
+}
+
+/**
+ * Samples the engine and redraws only the tiles whose duty changed.
+ */
+void LedPreview::refresh()
+{
+    m_engine.snapshotOutputs(m_snapshot);
+    if (m_snapshot.size() != m_drawnDuty.size())
+    {
+        updateGeometry();
+        rebuildImage();
+        return;
+    }
+
+    QPainter painter{&m_image};
+    for (std::size_t i{0}; i < m_snapshot.size(); ++i)
+    {
+        if (m_snapshot[i] != m_drawnDuty[i])
+        {
+            m_drawnDuty[i] = m_snapshot[i];
+            drawTile(painter, i);
+            update(tileRect(i));
+        }
+    }
+}
+
+void LedPreview::paintEvent(QPaintEvent *event)
+{
+    QPainter painter{this};
+    painter.drawImage(event->rect(), m_image, event->rect());
+}
+
+void LedPreview::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    rebuildImage();
+}
+
+void LedPreview::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    m_refreshTimer.start();
+}
+
+void LedPreview::hideEvent(QHideEvent *event)
+{
+    // Nothing to look at, so stop sampling the engine
+    m_refreshTimer.stop();
+    QWidget::hideEvent(event);
+}
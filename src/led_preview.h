@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QImage>  // Cached rendering of all channel tiles
+#include <QTimer>  // Refresh-rate polling of the engine
+#include <QWidget> // Base class for the preview
+#include <vector>  // Last drawn duty per channel
+#include "pwm_engine.h"
+
+/**
+ * Live preview of every channel as a colored tile whose brightness follows
+ * the duty cycle. Lets remote operators see what the physical LEDs show.
+ *
+ * The engine is sampled at most once per display refresh, no matter how
+ * often duties change. Changed tiles are redrawn into a cached QImage and
+ * only their rectangles are passed to update(), so repaint cost depends on
+ * what changed on screen, not on the engine tick rate.
+ *
+ * Tiles wrap onto as many rows as the channels need, up to a limit; on
+ * larger rigs, or when the layout gives less height, they shrink so every
+ * channel stays visible.
+ */
+class LedPreview : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LedPreview(PwmEngine &engine, QWidget *parent = nullptr);
+    ~LedPreview() override;
+
+    QSize sizeHint() const override;
+    bool hasHeightForWidth() const override { return true; }
+    int heightForWidth(int width) const override;
+
+    // Overrides the default (display refresh rate) sampling interval
+    void setRefreshInterval(int ms) { m_refreshTimer.setInterval(ms); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void refresh();
+    void rebuildImage();
+    void drawTile(QPainter &painter, std::size_t index) const;
+    QRect tileRect(std::size_t index) const;
+
+    PwmEngine &m_engine;
+    PwmEngine::ListenerId m_layoutListenerId{};
+    QTimer m_refreshTimer;
+    QImage m_image;
+    std::vector<int> m_snapshot;  // Outputs sampled on the latest refresh
+    std::vector<int> m_drawnDuty; // Outputs currently drawn in m_image
+    int m_columns{1};
+    int m_pitch{0};               // Tile spacing that fits every channel into the widget
+    int m_tile{0};
+};
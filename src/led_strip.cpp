@@ -0,0 +1,218 @@
+#include "led_strip.h"
+
+#include <algorithm>          // std::min, std::max, std::clamp, std::fill
+#include <array>              // Encoding tables
+#include <cstring>            // std::memcpy
+#include <fcntl.h>            // open, fcntl
+#include <linux/spi/spidev.h> // SPI_IOC_* ioctls
+#include <stdexcept>          // std::runtime_error
+#include <sys/ioctl.h>        // ioctl
+#include <sys/stat.h>         // fstat
+#include <unistd.h>           // write, pwrite, close
+
+// Low time after a frame that makes the LEDs latch it; newer WS2812B need
+// more than 280 us, and at WS281X_SPI_HZ 120 zero bytes last 300 us
+constexpr std::size_t ONE_WIRE_RESET_BYTES{120};
+
+// SPI nibbles of a data bit: the high time is the number of leading ones
+constexpr std::uint8_t ONE_WIRE_ZERO{0b1000};     // 312 ns high
+constexpr std::uint8_t WS2812_ONE{0b1110};        // 937 ns high
+constexpr std::uint8_t SK6812_ONE{0b1100};        // 625 ns high
+
+// Clocked chips: the zero start frame, and the header bits of a LED word
+constexpr std::size_t CLOCKED_START_BYTES{4};
+constexpr std::uint8_t CLOCKED_LED_HEADER{0xE0};
+constexpr std::uint32_t MAX_GLOBAL_BRIGHTNESS{31};
+
+static std::size_t bytesPerLed(StripChip chip)
+{
+    return chip == StripChip::Ws2812 ? 3 : 4;
+}
+
+/**
+ * Bytes on the wire for a strip: the encoded bits plus the reset gap, or
+ * start frame, LED words and end frame. Each LED delays the data by half
+ * a clock, so the end frame needs leds / 2 more clocks for it to reach the
+ * last one, plus the 32 bits the SK9822 needs to latch.
+ */
+static std::size_t frameBytes(StripChip chip, std::size_t leds)
+{
+    if (isClockedChip(chip))
+    {
+        return CLOCKED_START_BYTES + 4 * leds + 4 + (leds + 15) / 16;
+    }
+    return 4 * bytesPerLed(chip) * leds + ONE_WIRE_RESET_BYTES;
+}
+
+/**
+ * Wire bytes of every possible color byte, most significant bit first,
+ * stored so that a memcpy of the entry puts them in transmit order.
+ */
+static std::array<std::uint32_t, 256> buildOneWireTable(std::uint8_t one)
+{
+    std::array<std::uint32_t, 256> table{};
+    for (unsigned value{0}; value < table.size(); ++value)
+    {
+        std::uint8_t wire[4];
+        for (unsigned pair{0}; pair < 4; ++pair)
+        {
+            const bool high{((value >> (7 - 2 * pair)) & 1) != 0};
+            const bool low{((value >> (6 - 2 * pair)) & 1) != 0};
+            wire[pair] = static_cast<std::uint8_t>((high ? one : ONE_WIRE_ZERO) << 4 | (low ? one : ONE_WIRE_ZERO));
+        }
+        std::memcpy(&table[value], wire, sizeof(wire));
+    }
+    return table;
+}
+
+static const std::array<std::uint32_t, 256> &oneWireTable(StripChip chip)
+{
+    static const std::array<std::uint32_t, 256> WS2812_TABLE{buildOneWireTable(WS2812_ONE)};
+    static const std::array<std::uint32_t, 256> SK6812_TABLE{buildOneWireTable(SK6812_ONE)};
+    return chip == StripChip::Sk6812 ? SK6812_TABLE : WS2812_TABLE;
+}
+
+void encodeOneWire(StripChip chip, const std::uint8_t *pixels, std::size_t count, std::uint8_t *out)
+{
+    const std::uint32_t *table{oneWireTable(chip).data()};
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        std::memcpy(out + 4 * i, &table[pixels[i]], 4);
+    }
+}
+
+LedStrip::LedStrip(const std::string &device, StripChip chip, std::size_t leds, int speedHz)
+    : m_device{device}, m_chip{chip}, m_leds{leds}, m_speedHz{speedHz},
+      m_pixels(isClockedChip(chip) ? 0 : leds * bytesPerLed(chip)), m_frame(frameBytes(chip, leds))
+{
+    clear();
+
+    // Non-blocking so that a FIFO without a reader fails here instead of
+    // hanging; frames are then written blocking, so none is cut in half.
+    // Only test files are created; a mistyped /dev path must not become one.
+    const bool devicePath{device.rfind("/dev/", 0) == 0};
+    m_fd = open(device.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC | (devicePath ? 0 : O_CREAT), 0644);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error{"Cannot open strip device " + device};
+    }
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_NONBLOCK);
+
+    struct stat info{};
+    fstat(m_fd, &info);
+    if (devicePath && !S_ISCHR(info.st_mode))
+    {
+        close(m_fd);
+        throw std::runtime_error{device + " is not a device"};
+    }
+    m_regular = S_ISREG(info.st_mode);
+
+    const std::uint8_t mode{SPI_MODE_0};
+    const std::uint8_t bits{8};
+    const auto speed{static_cast<std::uint32_t>(m_speedHz)};
+    if (S_ISCHR(info.st_mode) && ioctl(m_fd, SPI_IOC_WR_MODE, &mode) == 0)
+    {
+        m_spi = true;
+        if (ioctl(m_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 || ioctl(m_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
+        {
+            close(m_fd);
+            throw std::runtime_error{"Cannot set up SPI on " + device};
+        }
+    }
+}
+
+LedStrip::~LedStrip()
+{
+    close(m_fd);
+}
+
+/**
+ * Splits the level between the global brightness field and the color:
+ * the brightness is the smallest that still lets the brightest component
+ * fit in 8 bits, so at low levels the colors keep their precision instead
+ * of collapsing to a few steps.
+ */
+static void setClockedPixel(std::uint8_t *word, std::uint32_t color, int level, int range)
+{
+    // Intended light per component, in 1/31 of a full-brightness color step
+    const auto light{[level, range](std::uint32_t component)
+                     { return component * static_cast<std::uint32_t>(level) * MAX_GLOBAL_BRIGHTNESS /
+                              static_cast<std::uint32_t>(range); }};
+    const std::uint32_t red{light(color >> 16 & 0xFF)};
+    const std::uint32_t green{light(color >> 8 & 0xFF)};
+    const std::uint32_t blue{light(color & 0xFF)};
+
+    const std::uint32_t brightness{std::clamp((std::max({red, green, blue}) + 254) / 255, 1u, MAX_GLOBAL_BRIGHTNESS)};
+    const auto component{[brightness](std::uint32_t value)
+                         { return static_cast<std::uint8_t>(std::min((value + brightness / 2) / brightness, 255u)); }};
+    word[0] = static_cast<std::uint8_t>(CLOCKED_LED_HEADER | brightness);
+    word[1] = component(blue);
+    word[2] = component(green);
+    word[3] = component(red);
+}
+
+void LedStrip::setPixel(std::size_t led, std::uint32_t color, int level, int range)
+{
+    if (isClockedChip(m_chip))
+    {
+        setClockedPixel(m_frame.data() + CLOCKED_START_BYTES + 4 * led, color, level, range);
+        return;
+    }
+
+    const auto scale{[level, range](std::uint32_t component)
+                     { return static_cast<std::uint8_t>((component * static_cast<std::uint32_t>(level) +
+                                                         static_cast<std::uint32_t>(range) / 2) /
+                                                        static_cast<std::uint32_t>(range)); }};
+    std::uint8_t red{scale(color >> 16 & 0xFF)};
+    std::uint8_t green{scale(color >> 8 & 0xFF)};
+    std::uint8_t blue{scale(color & 0xFF)};
+
+    std::uint8_t *pixel{m_pixels.data() + led * bytesPerLed(m_chip)};
+    if (m_chip == StripChip::Sk6812)
+    {
+        // The common part of the three colors goes to the white LED
+        const std::uint8_t white{std::min({red, green, blue})};
+        red = static_cast<std::uint8_t>(red - white);
+        green = static_cast<std::uint8_t>(green - white);
+        blue = static_cast<std::uint8_t>(blue - white);
+        pixel[3] = white;
+    }
+    pixel[0] = green;
+    pixel[1] = red;
+    pixel[2] = blue;
+}
+
+void LedStrip::clear()
+{
+    std::fill(m_pixels.begin(), m_pixels.end(), 0);
+    for (std::size_t led{0}; isClockedChip(m_chip) && led < m_leds; ++led)
+    {
+        std::uint8_t *word{m_frame.data() + CLOCKED_START_BYTES + 4 * led};
+        word[0] = CLOCKED_LED_HEADER;
+        word[1] = word[2] = word[3] = 0;
+    }
+}
+
+bool LedStrip::show()
+{
+    if (!isClockedChip(m_chip))
+    {
+        encodeOneWire(m_chip, m_pixels.data(), m_pixels.size(), m_frame.data());
+    }
+
+    const auto size{static_cast<ssize_t>(m_frame.size())};
+    if (m_spi)
+    {
+        spi_ioc_transfer transfer{};
+        transfer.tx_buf = reinterpret_cast<std::uintptr_t>(m_frame.data());
+        transfer.len = static_cast<std::uint32_t>(m_frame.size());
+        transfer.speed_hz = static_cast<std::uint32_t>(m_speedHz);
+        transfer.bits_per_word = 8;
+        return ioctl(m_fd, SPI_IOC_MESSAGE(1), &transfer) == size;
+    }
+    if (m_regular)
+    {
+        return pwrite(m_fd, m_frame.data(), m_frame.size(), 0) == size;
+    }
+    return write(m_fd, m_frame.data(), m_frame.size()) == size;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // Pixel and wire bytes
+#include <string>  // Device path
+#include <vector>  // Pixel and frame buffers
+
+// Addressable LED chips a strip can be made of
+enum class StripChip
+{
+    Ws2812, // GRB, 3 bytes per LED
+    Sk6812, // GRBW, 4 bytes per LED
+    Apa102, // Clocked: 5-bit global brightness + BGR, 4 bytes per LED
+    Sk9822  // APA102 compatible, needs an extra reset frame
+};
+
+// SPI clock of the one-wire chips: 4 SPI bits per data bit, 312.5 ns each
+constexpr int WS281X_SPI_HZ{3200000};
+// Default clock of the clocked chips; they take up to about 20 MHz on short runs
+constexpr int APA102_SPI_HZ{8000000};
+
+// Data and clock (APA102, SK9822) rather than a single timed data line
+constexpr bool isClockedChip(StripChip chip)
+{
+    return chip == StripChip::Apa102 || chip == StripChip::Sk9822;
+}
+
+/**
+ * Encodes count pixel bytes into the SPI bit stream of a one-wire chip:
+ * every data bit becomes 4 SPI bits (1000 for a 0, 1110 or 1100 for a 1),
+ * so out must hold 4 * count bytes. One table lookup per byte.
+ */
+void encodeOneWire(StripChip chip, const std::uint8_t *pixels, std::size_t count, std::uint8_t *out);
+
+/**
+ * An addressable LED strip on a spidev device. Every channel placed on the
+ * strip is one LED showing its color at its output level.
+ *
+ * show() sends the whole strip as a single SPI transfer, so one-wire chips
+ * never see a gap long enough to latch half a frame. One-wire pixels are
+ * kept as color bytes and encoded into the bit stream first. Clocked
+ * pixels are written straight into the wire-format frame (start frame, one
+ * brightness/B/G/R word per LED, end frame), which is then sent as it is.
+ * Their 5-bit global brightness field carries the coarse part of the level,
+ * so dim levels keep most of the 8-bit color resolution.
+ *
+ * The device may also be a regular file or a FIFO, which receive the
+ * frames as they would go out on the wire: a file holds the latest frame,
+ * a pipe gets every frame in turn. Files outside /dev are created; a path
+ * in /dev must be an existing character device.
+ */
+class LedStrip
+{
+public:
+    // Opens and configures the device; throws std::runtime_error on failure
+    LedStrip(const std::string &device, StripChip chip, std::size_t leds, int speedHz);
+    ~LedStrip();
+
+    LedStrip(const LedStrip &) = delete;
+    LedStrip &operator=(const LedStrip &) = delete;
+
+    // Sets an LED from 0xRRGGBB scaled by level / range
+    void setPixel(std::size_t led, std::uint32_t color, int level, int range);
+    void clear();
+
+    // Encodes and sends the frame; false if the device did not take it
+    bool show();
+
+    const std::string &device() const { return m_device; }
+    StripChip chip() const { return m_chip; }
+    std::size_t ledCount() const { return m_leds; }
+    int speedHz() const { return m_speedHz; }
+    const std::vector<std::uint8_t> &frame() const { return m_frame; }
+
+private:
+    std::string m_device;
+    StripChip m_chip;
+    std::size_t m_leds;
+    int m_speedHz;
+    int m_fd{-1};
+    bool m_spi{false};     // spidev: one ioctl transfer instead of write()
+    bool m_regular{false}; // Regular file: rewritten from the start every frame
+    std::vector<std::uint8_t> m_pixels; // One-wire color bytes in wire order
+    std::vector<std::uint8_t> m_frame;  // Exactly the bytes sent on the wire
+};
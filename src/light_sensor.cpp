@@ -0,0 +1,146 @@
+#include "light_sensor.h"
+
+#include <cmath>     // std::exp
+#include <cstdlib>   // strtod_l
+#include <fcntl.h>   // open
+#include <locale.h>  // newlocale
+#include <stdexcept> // std::runtime_error
+#include <unistd.h>  // pread, close
+
+// Samples older than this are not used
+constexpr std::chrono::seconds MAX_SAMPLE_AGE{1};
+
+static std::int64_t steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Parses a number the way sysfs writes it. QApplication sets the user's
+ * locale, where the decimal separator may be a comma, so the C locale is
+ * asked for explicitly.
+ */
+static double parseNumber(const char *text, char **end)
+{
+    static const locale_t cLocale{newlocale(LC_ALL_MASK, "C", nullptr)};
+    return strtod_l(text, end, cLocale);
+}
+
+/**
+ * Reads a number from a sysfs attribute; fallback if the file is missing.
+ */
+static double readAttribute(const std::string &path, double fallback)
+{
+    const int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0)
+    {
+        return fallback;
+    }
+    char text[64]{};
+    const ssize_t length{pread(fd, text, sizeof(text) - 1, 0)};
+    close(fd);
+    return length > 0 ? parseNumber(text, nullptr) : fallback;
+}
+
+IioLightSensor::IioLightSensor(const std::string &path, std::chrono::milliseconds period)
+    : m_path{path}, m_period{period}
+{
+    m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error{"Cannot open light sensor " + path};
+    }
+    const std::string suffix{"_raw"};
+    if (path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0)
+    {
+        const std::string base{path.substr(0, path.size() - suffix.size())};
+        m_scale = readAttribute(base + "_scale", 1.0);
+        m_offset = readAttribute(base + "_offset", 0.0);
+    }
+    m_sampler = std::thread{[this]()
+                            { samplerLoop(); }};
+}
+
+IioLightSensor::~IioLightSensor()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_sampler.join();
+    close(m_fd);
+}
+
+bool IioLightSensor::sample(double &lux) const
+{
+    // sysfs attributes are read from offset 0 each time, without reopening
+    char text[64]{};
+    const ssize_t length{pread(m_fd, text, sizeof(text) - 1, 0)};
+    char *end{nullptr};
+    const double value{length > 0 ? parseNumber(text, &end) : 0.0};
+    if (length <= 0 || end == text)
+    {
+        return false;
+    }
+    lux = (value + m_offset) * m_scale;
+    return true;
+}
+
+void IioLightSensor::samplerLoop()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (!m_stop)
+    {
+        lock.unlock();
+        double lux{0.0};
+        if (sample(lux))
+        {
+            m_lux.store(lux, std::memory_order_relaxed);
+            m_sampledNs.store(steadyNs(), std::memory_order_release);
+        }
+        lock.lock();
+        m_wake.wait_for(lock, m_period, [this]()
+                        { return m_stop; });
+    }
+}
+
+bool IioLightSensor::read(double, double, double &lux)
+{
+    const std::int64_t sampled{m_sampledNs.load(std::memory_order_acquire)};
+    if (sampled == 0 || steadyNs() - sampled > std::chrono::nanoseconds{MAX_SAMPLE_AGE}.count())
+    {
+        return false;
+    }
+    lux = m_lux.load(std::memory_order_relaxed);
+    return true;
+}
+
+double SimulatedLightSensor::daylight(double time) const
+{
+    const bool bright{static_cast<long long>(std::floor(time * 2.0 / m_room.period)) % 2 == 0};
+    return m_room.ambient + (bright ? m_room.swing : -m_room.swing);
+}
+
+bool SimulatedLightSensor::read(double time, double rigOutput, double &lux)
+{
+    const double actual{daylight(time) + m_room.led * rigOutput};
+    if (m_filtered < 0.0)
+    {
+        m_filtered = actual;
+    }
+    else if (m_room.lag > 0.0)
+    {
+        m_filtered += (actual - m_filtered) * (1.0 - std::exp(-(time - m_lastTime) / m_room.lag));
+    }
+    else
+    {
+        m_filtered = actual;
+    }
+    m_lastTime = time;
+
+    std::uniform_real_distribution<double> noise{-m_room.noise, m_room.noise};
+    lux = m_filtered * (1.0 + noise(m_random));
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>             // Latest sample, shared with the sampler thread
+#include <chrono>             // Sampling period
+#include <condition_variable> // Stopping the sampler promptly
+#include <cstdint>            // Sample timestamps
+#include <mutex>              // Sampler stop flag
+#include <random>             // Simulated sensor noise
+#include <string>             // Device paths
+#include <thread>             // Sampler thread
+
+/**
+ * Where the ambient loop (see ambient_control.h) gets its light reading.
+ *
+ * read() is called on the engine thread once per control step and must
+ * return at once. time is the engine time in seconds; rigOutput is the
+ * mean output of the channels the loop controls (0–1), which a simulated
+ * room adds to its daylight and real sensors ignore.
+ */
+class LightSensor
+{
+public:
+    virtual ~LightSensor() = default;
+
+    // The current reading in lux; false if there is none (the loop then holds its gain)
+    virtual bool read(double time, double rigOutput, double &lux) = 0;
+
+    virtual std::string description() const = 0;
+};
+
+/**
+ * A Linux IIO light sensor through sysfs, e.g.
+ * /sys/bus/iio/devices/iio:device0/in_illuminance_input. For a _raw file
+ * the _scale and _offset next to it are applied.
+ *
+ * Reading sysfs waits for the driver, which for I2C sensors can take as
+ * long as a conversion, so a thread samples the file and read() only
+ * picks up the latest value. Samples older than a second count as none.
+ */
+class IioLightSensor : public LightSensor
+{
+public:
+    // Opens the file; throws std::runtime_error on failure
+    IioLightSensor(const std::string &path, std::chrono::milliseconds period);
+    ~IioLightSensor() override;
+
+    IioLightSensor(const IioLightSensor &) = delete;
+    IioLightSensor &operator=(const IioLightSensor &) = delete;
+
+    bool read(double time, double rigOutput, double &lux) override;
+    std::string description() const override { return m_path; }
+
+    const std::string &path() const { return m_path; }
+    std::chrono::milliseconds period() const { return m_period; }
+
+private:
+    bool sample(double &lux) const;
+    void samplerLoop();
+
+    std::string m_path;
+    int m_fd{-1};
+    double m_scale{1.0};
+    double m_offset{0.0};
+    std::chrono::milliseconds m_period;
+
+    std::atomic<double> m_lux{0.0};
+    std::atomic<std::int64_t> m_sampledNs{0}; // steady_clock time of m_lux, 0 = none yet
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop{false};
+    std::thread m_sampler;
+};
+
+// A room for the simulated sensor: daylight that jumps between two levels, plus the rig
+struct SimulatedRoom
+{
+    double ambient{150.0};  // Mean daylight in lux
+    double swing{100.0};    // Daylight is ambient ± swing, switching every period / 2
+    double period{60.0};    // Seconds
+    double led{400.0};      // Lux the controlled channels add at full output
+    double lag{0.3};        // Time constant of the sensor in seconds
+    double noise{0.01};     // Relative noise of each reading
+};
+
+/**
+ * A sensor in a simulated room, driven by engine time, for trying the
+ * loop without hardware and for --ambient-bench.
+ */
+class SimulatedLightSensor : public LightSensor
+{
+public:
+    explicit SimulatedLightSensor(const SimulatedRoom &room) : m_room{room} {}
+
+    bool read(double time, double rigOutput, double &lux) override;
+    std::string description() const override { return "simulated"; }
+
+    // Daylight at time, without the rig
+    double daylight(double time) const;
+
+private:
+    SimulatedRoom m_room;
+    double m_filtered{-1.0}; // Sensor reading before noise, -1 = not started
+    double m_lastTime{0.0};
+    std::minstd_rand m_random{1};
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>  // std::remove_if
+#include <cstddef>    // std::size_t
+#include <functional> // std::function callbacks
+#include <utility>    // std::pair, std::move
+#include <vector>     // Registered callbacks
+
+/**
+ * A list of callbacks that can be removed again by the id returned when
+ * they were added. Used by the engine for its change notifications.
+ */
+template <typename... Args>
+class ListenerList
+{
+public:
+    using Callback = std::function<void(Args...)>;
+    using Id = std::size_t;
+
+    Id add(Callback callback)
+    {
+        m_callbacks.emplace_back(m_nextId, std::move(callback));
+        return m_nextId++;
+    }
+
+    void remove(Id id)
+    {
+        m_callbacks.erase(std::remove_if(m_callbacks.begin(), m_callbacks.end(),
+                                         [id](const auto &entry)
+                                         { return entry.first == id; }),
+                          m_callbacks.end());
+    }
+
+    void notify(Args... args) const
+    {
+        for (const auto &entry : m_callbacks)
+        {
+            entry.second(args...);
+        }
+    }
+
+    bool empty() const { return m_callbacks.empty(); }
+
+private:
+    std::vector<std::pair<Id, Callback>> m_callbacks;
+    Id m_nextId{0};
+};
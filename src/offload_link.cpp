@@ -0,0 +1,207 @@
+#include "offload_link.h"
+
+#include <algorithm>             // std::fill
+#include <fcntl.h>               // open
+#include <stdexcept>             // std::runtime_error
+#include <string>                // std::to_string
+#include <termios.h>             // Raw mode and baud rate
+#include <unistd.h>              // write, close
+#include "offload_protocol.h"
+
+// Longest time between two keyframes, so a receiver that lost a frame or
+// was reset catches up
+constexpr std::chrono::seconds KEYFRAME_INTERVAL{1};
+// Unchanged channels between two changed ones that are sent as a zero
+// difference (a byte each) rather than starting a new run (two bytes)
+constexpr std::size_t MAX_MERGED_GAP{2};
+
+static speed_t baudConstant(int baud)
+{
+    switch (baud)
+    {
+    case 115200:
+        return B115200;
+    case 230400:
+        return B230400;
+    case 460800:
+        return B460800;
+    case 921600:
+        return B921600;
+    case 1000000:
+        return B1000000;
+    case 1500000:
+        return B1500000;
+    case 2000000:
+        return B2000000;
+    case 3000000:
+        return B3000000;
+    default:
+        throw std::runtime_error{"Unsupported baud rate " + std::to_string(baud)};
+    }
+}
+
+static void appendVarint(std::vector<std::uint8_t> &out, std::uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+OffloadLink::OffloadLink(const std::string &device, int baud, std::size_t channels)
+    : m_device{device}, m_baud{baud}, m_levels(channels, 0), m_sent(channels, 0)
+{
+    const speed_t speed{baudConstant(baud)};
+    if (channels > OFFLOAD_MAX_CHANNELS)
+    {
+        throw std::runtime_error{"More than " + std::to_string(OFFLOAD_MAX_CHANNELS) + " channels on " + device};
+    }
+
+    m_fd = open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    termios settings{};
+    if (m_fd < 0 || tcgetattr(m_fd, &settings) < 0)
+    {
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        throw std::runtime_error{"Cannot open serial port " + device};
+    }
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, speed);
+    cfsetospeed(&settings, speed);
+    settings.c_cflag |= CLOCAL | CREAD;
+    tcsetattr(m_fd, TCSANOW, &settings);
+
+    m_payload.reserve(OFFLOAD_MAX_PAYLOAD);
+    m_frame.reserve(OFFLOAD_HEADER_BYTES + OFFLOAD_MAX_PAYLOAD + OFFLOAD_CRC_BYTES);
+}
+
+OffloadLink::~OffloadLink()
+{
+    close(m_fd);
+}
+
+void OffloadLink::setOutput(std::size_t channel, int level, int range)
+{
+    m_levels[channel] = static_cast<std::uint16_t>(static_cast<long long>(level) * 0xFFFF / range);
+    m_changed = true;
+}
+
+void OffloadLink::allOff()
+{
+    std::fill(m_levels.begin(), m_levels.end(), 0);
+    m_keyframeDue = true;
+    flush();
+}
+
+bool OffloadLink::flush()
+{
+    const auto now{std::chrono::steady_clock::now()};
+    if (!m_changed && !m_keyframeDue && now - m_lastKeyframe < KEYFRAME_INTERVAL)
+    {
+        return true;
+    }
+    m_changed = false;
+
+    if (m_keyframeDue || now - m_lastKeyframe >= KEYFRAME_INTERVAL || !buildDelta())
+    {
+        buildKeyframe();
+        m_lastKeyframe = now;
+        return send(OFFLOAD_KEYFRAME);
+    }
+    return m_payload.empty() || send(OFFLOAD_DELTA);
+}
+
+void OffloadLink::buildKeyframe()
+{
+    m_payload.clear();
+    m_payload.push_back(static_cast<std::uint8_t>(m_levels.size() & 0xFF));
+    m_payload.push_back(static_cast<std::uint8_t>(m_levels.size() >> 8));
+    for (std::uint16_t level : m_levels)
+    {
+        m_payload.push_back(static_cast<std::uint8_t>(level & 0xFF));
+        m_payload.push_back(static_cast<std::uint8_t>(level >> 8));
+    }
+}
+
+/**
+ * Builds the delta against m_sent; false if it would not be smaller than
+ * a keyframe.
+ */
+bool OffloadLink::buildDelta()
+{
+    const std::size_t keyframeBytes{2 + 2 * m_levels.size()};
+    const std::size_t count{m_levels.size()};
+    m_payload.clear();
+
+    std::size_t previousEnd{0};
+    for (std::size_t channel{0}; channel < count;)
+    {
+        if (m_levels[channel] == m_sent[channel])
+        {
+            ++channel;
+            continue;
+        }
+
+        // Extend the run over short gaps of unchanged channels
+        std::size_t end{channel + 1};
+        for (std::size_t next{end}; next < count && next <= end + MAX_MERGED_GAP; ++next)
+        {
+            if (m_levels[next] != m_sent[next])
+            {
+                end = next + 1;
+            }
+        }
+
+        appendVarint(m_payload, static_cast<std::uint32_t>(channel - previousEnd));
+        appendVarint(m_payload, static_cast<std::uint32_t>(end - channel));
+        for (; channel < end; ++channel)
+        {
+            const std::int32_t difference{static_cast<std::int32_t>(m_levels[channel]) - m_sent[channel]};
+            appendVarint(m_payload, static_cast<std::uint32_t>(difference) << 1 ^ static_cast<std::uint32_t>(difference >> 31));
+        }
+        previousEnd = end;
+
+        if (m_payload.size() >= keyframeBytes)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Frames m_payload and writes it in one go. The receiver only has what was
+ * sent once the port took the whole frame.
+ */
+bool OffloadLink::send(std::uint8_t type)
+{
+    const std::uint8_t sequence{static_cast<std::uint8_t>(m_sequence + 1)};
+    m_frame.assign({OFFLOAD_SYNC, sequence, type, static_cast<std::uint8_t>(m_payload.size() & 0xFF),
+                    static_cast<std::uint8_t>(m_payload.size() >> 8)});
+    m_frame.insert(m_frame.end(), m_payload.begin(), m_payload.end());
+    const std::uint16_t crc{offload_crc16(m_frame.data() + 1, m_frame.size() - 1)};
+    m_frame.push_back(static_cast<std::uint8_t>(crc & 0xFF));
+    m_frame.push_back(static_cast<std::uint8_t>(crc >> 8));
+
+    const ssize_t written{write(m_fd, m_frame.data(), m_frame.size())};
+    if (written != static_cast<ssize_t>(m_frame.size()))
+    {
+        // A partial frame fails the receiver's CRC; the keyframe resynchronizes it
+        ++m_stats.dropped;
+        m_stats.bytes += written > 0 ? static_cast<std::size_t>(written) : 0;
+        m_keyframeDue = true;
+        return false;
+    }
+
+    m_sequence = sequence;
+    m_sent = m_levels;
+    m_keyframeDue = false;
+    ++m_stats.frames;
+    m_stats.keyframes += type == OFFLOAD_KEYFRAME ? 1 : 0;
+    m_stats.bytes += m_frame.size();
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>  // Keyframe interval
+#include <cstddef> // std::size_t
+#include <cstdint> // Levels and frame bytes
+#include <string>  // Device path
+#include <vector>  // Level and frame buffers
+
+// Traffic of a link since it was opened
+struct OffloadStats
+{
+    std::size_t frames{0};    // Frames written
+    std::size_t keyframes{0}; // Of which full frames
+    std::size_t bytes{0};     // Bytes written
+    std::size_t dropped{0};   // Frames the port did not take in full
+};
+
+/**
+ * Streams output levels to a microcontroller on a serial port, which then
+ * drives the outputs on its own clock (see offload_protocol.h for the wire
+ * format and the reference receiver).
+ *
+ * flush() sends the channels that changed since the last frame as one
+ * delta frame: runs of changed channels, each level as the difference to
+ * the previous one, so a fade costs about a byte per channel. A keyframe
+ * with every level goes out first, once a second, whenever a delta would
+ * be larger, and after a frame the port could not take.
+ *
+ * Writes never block the engine: a frame that does not fit into the
+ * port's buffer is dropped and followed by a keyframe.
+ */
+class OffloadLink
+{
+public:
+    // Opens the port in raw mode; throws std::runtime_error on failure
+    OffloadLink(const std::string &device, int baud, std::size_t channels);
+    ~OffloadLink();
+
+    OffloadLink(const OffloadLink &) = delete;
+    OffloadLink &operator=(const OffloadLink &) = delete;
+
+    // Sets a channel to level / range; sent by the next flush()
+    void setOutput(std::size_t channel, int level, int range);
+    // Turns every channel off with a keyframe
+    void allOff();
+
+    // Sends a frame if anything changed or a keyframe is due
+    bool flush();
+
+    const std::string &device() const { return m_device; }
+    int baud() const { return m_baud; }
+    std::size_t channelCount() const { return m_levels.size(); }
+    const OffloadStats &stats() const { return m_stats; }
+
+private:
+    void buildKeyframe();
+    bool buildDelta();
+    bool send(std::uint8_t type);
+
+    std::string m_device;
+    int m_baud;
+    int m_fd{-1};
+    std::vector<std::uint16_t> m_levels; // Current level per channel
+    std::vector<std::uint16_t> m_sent;   // What the receiver has
+    bool m_changed{false};
+    bool m_keyframeDue{true};
+    std::chrono::steady_clock::time_point m_lastKeyframe;
+    std::uint8_t m_sequence{0};
+    std::vector<std::uint8_t> m_payload;
+    std::vector<std::uint8_t> m_frame;
+    OffloadStats m_stats;
+};
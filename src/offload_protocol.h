@@ -0,0 +1,71 @@
+/*
+ * The serial protocol between the engine and a microcontroller that drives
+ * the outputs itself (see offload_link.h), and the reference receiver.
+ *
+ * Frame, all numbers little endian:
+ *   0xA5 | sequence (u8) | type (u8) | payload length (u16) | payload | CRC
+ * The CRC is CRC-16/CCITT-FALSE over everything from the sequence number
+ * to the end of the payload.
+ *
+ * Payloads:
+ *   OFFLOAD_KEYFRAME  count (u16), then count levels (u16)
+ *   OFFLOAD_DELTA     runs of changed channels: skip (varint, channels
+ *                     left unchanged since the end of the previous run),
+ *                     length (varint), then length signed differences to
+ *                     the previous level (zigzag varint)
+ * Levels are 0–65535 regardless of the channel's PWM range.
+ *
+ * A delta only applies on top of the frame before it. After a gap in the
+ * sequence numbers or a bad CRC the receiver ignores deltas until the next
+ * keyframe, which the sender sends at least once a second.
+ *
+ * The receiver is plain C without allocation so that it can be compiled
+ * into microcontroller firmware unchanged. Bytes are fed one at a time,
+ * e.g. from the UART interrupt.
+ */
+#ifndef PWM_OFFLOAD_PROTOCOL_H
+#define PWM_OFFLOAD_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OFFLOAD_SYNC 0xA5
+#define OFFLOAD_KEYFRAME 0
+#define OFFLOAD_DELTA 1
+#define OFFLOAD_HEADER_BYTES 5
+#define OFFLOAD_CRC_BYTES 2
+#define OFFLOAD_MAX_CHANNELS 1024
+/* A keyframe of OFFLOAD_MAX_CHANNELS is the largest payload */
+#define OFFLOAD_MAX_PAYLOAD (2 + 2 * OFFLOAD_MAX_CHANNELS)
+
+typedef struct OffloadReceiver
+{
+    uint16_t *levels; /* Current level per channel, owned by the caller */
+    uint16_t count;
+
+    uint8_t frame[OFFLOAD_HEADER_BYTES + OFFLOAD_MAX_PAYLOAD + OFFLOAD_CRC_BYTES];
+    size_t position;   /* Bytes of the current frame received, 0 = waiting for sync */
+    uint8_t sequence;  /* Of the last frame applied */
+    int synchronized;  /* A keyframe was applied and nothing lost since */
+
+    uint32_t frames;    /* Frames applied */
+    uint32_t crcErrors; /* Frames dropped for a bad CRC or length */
+    uint32_t lost;      /* Deltas skipped after a sequence gap */
+} OffloadReceiver;
+
+uint16_t offload_crc16(const uint8_t *data, size_t length);
+
+void offload_receiver_init(OffloadReceiver *receiver, uint16_t *levels, uint16_t count);
+
+/* Returns 1 if the byte completed a frame that was applied to the levels */
+int offload_receiver_feed(OffloadReceiver *receiver, uint8_t byte);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
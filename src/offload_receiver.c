@@ -0,0 +1,176 @@
+/*
+ * Reference receiver of the offload protocol (see offload_protocol.h).
+ */
+#include <string.h>
+#include "offload_protocol.h"
+
+uint16_t offload_crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) != 0 ? (uint16_t)(crc << 1 ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void offload_receiver_init(OffloadReceiver *receiver, uint16_t *levels, uint16_t count)
+{
+    memset(receiver, 0, sizeof(*receiver));
+    receiver->levels = levels;
+    receiver->count = count;
+}
+
+/* Reads a varint; returns 0 if it runs past end */
+static int readVarint(const uint8_t **cursor, const uint8_t *end, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 32 && *cursor < end; shift += 7)
+    {
+        const uint8_t byte = *(*cursor)++;
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int applyKeyframe(OffloadReceiver *receiver, const uint8_t *payload, size_t length)
+{
+    if (length < 2)
+    {
+        return 0;
+    }
+    const uint16_t count = (uint16_t)(payload[0] | payload[1] << 8);
+    if (count != receiver->count || length != 2 + 2 * (size_t)count)
+    {
+        return 0;
+    }
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        receiver->levels[i] = (uint16_t)(payload[2 + 2 * i] | payload[3 + 2 * i] << 8);
+    }
+    return 1;
+}
+
+/* Checks the whole delta before touching the levels, so a bad one changes nothing */
+static int applyDelta(OffloadReceiver *receiver, const uint8_t *payload, size_t length, int write)
+{
+    const uint8_t *cursor = payload;
+    const uint8_t *end = payload + length;
+    uint32_t channel = 0;
+    while (cursor < end)
+    {
+        uint32_t skip;
+        uint32_t run;
+        if (!readVarint(&cursor, end, &skip) || !readVarint(&cursor, end, &run))
+        {
+            return 0;
+        }
+        /* channel never exceeds count, so these cannot wrap the way channel + skip + run could */
+        if (skip > receiver->count - channel)
+        {
+            return 0;
+        }
+        channel += skip;
+        if (run > receiver->count - channel)
+        {
+            return 0;
+        }
+        for (uint32_t i = 0; i < run; ++i, ++channel)
+        {
+            uint32_t zigzag;
+            if (!readVarint(&cursor, end, &zigzag))
+            {
+                return 0;
+            }
+            const int32_t difference = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            if (write)
+            {
+                receiver->levels[channel] = (uint16_t)(receiver->levels[channel] + difference);
+            }
+        }
+    }
+    return 1;
+}
+
+/* Called with a complete frame whose CRC matched */
+static int applyFrame(OffloadReceiver *receiver)
+{
+    const uint8_t sequence = receiver->frame[1];
+    const uint8_t type = receiver->frame[2];
+    const size_t length = (size_t)(receiver->frame[3] | receiver->frame[4] << 8);
+    const uint8_t *payload = receiver->frame + OFFLOAD_HEADER_BYTES;
+
+    if (type == OFFLOAD_KEYFRAME)
+    {
+        if (!applyKeyframe(receiver, payload, length))
+        {
+            ++receiver->crcErrors;
+            return 0;
+        }
+        receiver->synchronized = 1;
+    }
+    else
+    {
+        if (!receiver->synchronized || sequence != (uint8_t)(receiver->sequence + 1))
+        {
+            receiver->synchronized = 0;
+            ++receiver->lost;
+            return 0;
+        }
+        if (!applyDelta(receiver, payload, length, 0))
+        {
+            receiver->synchronized = 0;
+            ++receiver->crcErrors;
+            return 0;
+        }
+        applyDelta(receiver, payload, length, 1);
+    }
+    receiver->sequence = sequence;
+    ++receiver->frames;
+    return 1;
+}
+
+int offload_receiver_feed(OffloadReceiver *receiver, uint8_t byte)
+{
+    if (receiver->position == 0 && byte != OFFLOAD_SYNC)
+    {
+        return 0; /* Between frames, or resynchronizing after an error */
+    }
+    receiver->frame[receiver->position++] = byte;
+    if (receiver->position < OFFLOAD_HEADER_BYTES)
+    {
+        return 0;
+    }
+
+    const size_t length = (size_t)(receiver->frame[3] | receiver->frame[4] << 8);
+    if (length > OFFLOAD_MAX_PAYLOAD)
+    {
+        ++receiver->crcErrors;
+        receiver->synchronized = 0;
+        receiver->position = 0;
+        return 0;
+    }
+    const size_t total = OFFLOAD_HEADER_BYTES + length + OFFLOAD_CRC_BYTES;
+    if (receiver->position < total)
+    {
+        return 0;
+    }
+
+    receiver->position = 0;
+    const uint16_t crc = (uint16_t)(receiver->frame[total - 2] | receiver->frame[total - 1] << 8);
+    if (offload_crc16(receiver->frame + 1, total - 1 - OFFLOAD_CRC_BYTES) != crc)
+    {
+        ++receiver->crcErrors;
+        receiver->synchronized = 0;
+        return 0;
+    }
+    return applyFrame(receiver);
+}
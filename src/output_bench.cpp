@@ -0,0 +1,438 @@
+#include "output_bench.h"
+
+#include <QElapsedTimer> // Frame timing
+#include <QtGlobal>      // qInfo
+#include <algorithm>     // Latency percentiles
+#include <chrono>        // Latency
+#include <cstdlib>       // std::abs
+#include <fcntl.h>       // posix_openpt
+#include <poll.h>        // Waiting for the receiver side
+#include <random>        // Slider levels of the slew benchmark
+#include <stdexcept>     // std::runtime_error
+#include <sys/wait.h>    // Reaping the frame producer
+#include <termios.h>     // Raw mode on the pty master
+#include <unistd.h>      // read, fork
+#include <cstdint>       // Pixel bytes
+#include <memory>        // std::make_shared
+#include <string>        // Run names
+#include <vector>        // Pixel and frame buffers
+#include "frame_ring.h"
+#include "led_strip.h"
+#include "offload_protocol.h"
+#include "pwm_engine.h"
+
+static void printResult(const char *name, int leds, int frames, qint64 elapsedNs)
+{
+    const double frameUs{static_cast<double>(elapsedNs) / frames / 1000.0};
+    qInfo("%-14s %d LEDs: %.1f us/frame, %.0f LEDs/ms", name, leds, frameUs, leds / frameUs * 1000.0);
+}
+
+/**
+ * Sets every LED of a strip on /dev/null and sends it, once per frame.
+ */
+static void runShow(const char *name, StripChip chip, int leds, int frames)
+{
+    LedStrip strip{"/dev/null", chip, static_cast<std::size_t>(leds), WS281X_SPI_HZ};
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame{0}; frame < frames; ++frame)
+    {
+        for (std::size_t led{0}; led < strip.ledCount(); ++led)
+        {
+            strip.setPixel(led, 0xFF8040, (frame + static_cast<int>(led)) & 0xFF, 255);
+        }
+        strip.show();
+    }
+    printResult((std::string{name} + " + show").c_str(), leds, frames, timer.nsecsElapsed());
+}
+
+void runStripBenchmark(int leds, int frames)
+{
+    struct Run
+    {
+        const char *name;
+        StripChip chip;
+        std::size_t bytesPerLed;
+    };
+    static const Run RUNS[]{{"ws2812", StripChip::Ws2812, 3},
+                            {"sk6812", StripChip::Sk6812, 4},
+                            {"apa102", StripChip::Apa102, 4}, // Written in wire format, nothing to encode
+                            {"sk9822", StripChip::Sk9822, 4}};
+
+    for (const Run &run : RUNS)
+    {
+        if (isClockedChip(run.chip))
+        {
+            runShow(run.name, run.chip, leds, frames);
+            continue;
+        }
+
+        const auto count{static_cast<std::size_t>(leds) * run.bytesPerLed};
+        std::vector<std::uint8_t> pixels(count);
+        std::vector<std::uint8_t> wire(count * 4);
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            pixels[i] = static_cast<std::uint8_t>(i * 37);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int frame{0}; frame < frames; ++frame)
+        {
+            ++pixels[static_cast<std::size_t>(frame) % count]; // Keeps the encode from being hoisted
+            encodeOneWire(run.chip, pixels.data(), count, wire.data());
+        }
+        printResult(run.name, leds, frames, timer.nsecsElapsed());
+        runShow(run.name, run.chip, leds, frames);
+    }
+}
+
+static ExpanderStats sumStats(const RigConfig &config)
+{
+    ExpanderStats sum;
+    for (const ExpanderConfig &expander : config.expanders)
+    {
+        sum.transfers += expander.output->stats().transfers;
+        sum.messages += expander.output->stats().messages;
+        sum.outputs += expander.output->stats().outputs;
+        sum.bytes += expander.output->stats().bytes;
+    }
+    return sum;
+}
+
+void runExpanderBenchmark(int channels, int frames)
+{
+    // Fast mode I2C, 9 clocks per byte
+    constexpr double I2C_HZ{400000.0};
+    static const Pattern PATTERNS[]{Pattern::Manual, Pattern::Fade, Pattern::Fire, Pattern::Twinkle};
+
+    RigConfig config;
+    const std::size_t boards{(static_cast<std::size_t>(channels) + PCA9685_OUTPUTS - 1) / PCA9685_OUTPUTS};
+    for (std::size_t board{0}; board < boards; ++board)
+    {
+        const std::string name{"Board " + std::to_string(board + 1)};
+        const std::string device{"/tmp/pwm-pca9685-" + std::to_string(board + 1) + ".bin"};
+        config.expanders.push_back(
+            ExpanderConfig{name, std::make_shared<Pca9685>(device, PCA9685_DEFAULT_ADDRESS, 1000)});
+    }
+    for (int i{0}; i < channels; ++i)
+    {
+        const std::size_t board{static_cast<std::size_t>(i) / PCA9685_OUTPUTS};
+        ChannelConfig channel{"Channel " + std::to_string(i + 1)};
+        channel.pattern = PATTERNS[board % std::size(PATTERNS)];
+        channel.expander = config.expanders[board].name;
+        channel.expanderOutput = static_cast<int>(static_cast<std::size_t>(i) % PCA9685_OUTPUTS);
+        config.channels.push_back(std::move(channel));
+    }
+    const auto shared{std::make_shared<const RigConfig>(std::move(config))};
+
+    PwmEngine engine;
+    engine.setHardwareOutput(false);
+    engine.applyConfig(shared);
+
+    const ExpanderStats before{sumStats(*shared)};
+    for (int frame{0}; frame < frames; ++frame)
+    {
+        engine.tick();
+    }
+    const ExpanderStats after{sumStats(*shared)};
+
+    const double perFrame{1.0 / frames};
+    const auto bytes{static_cast<double>(after.bytes - before.bytes) * perFrame};
+    qInfo("%d channels on %zu boards: %.1f transfers, %.1f messages, %.1f outputs, %.0f bytes per frame",
+          channels, boards, static_cast<double>(after.transfers - before.transfers) * perFrame,
+          static_cast<double>(after.messages - before.messages) * perFrame,
+          static_cast<double>(after.outputs - before.outputs) * perFrame, bytes);
+    qInfo("%.2f ms of a 400 kHz bus per frame", bytes * 9.0 / I2C_HZ * 1000.0);
+}
+
+void runOffloadBenchmark(int channels, int frames)
+{
+    constexpr int BAUD{921600};
+    // How long the receiver side waits for a frame; none comes when nothing changed
+    constexpr int RECEIVE_TIMEOUT_MS{5};
+    static const Pattern PATTERNS[]{Pattern::Manual, Pattern::Fade, Pattern::Fire, Pattern::Twinkle};
+
+    // The receiver reads the master side, the link writes to the slave like to a UART
+    const int master{posix_openpt(O_RDWR | O_NOCTTY)};
+    termios settings{};
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0 || tcgetattr(master, &settings) < 0)
+    {
+        throw std::runtime_error{"Cannot create a pseudo-terminal"};
+    }
+    cfmakeraw(&settings);
+    tcsetattr(master, TCSANOW, &settings);
+
+    RigConfig config;
+    for (int i{0}; i < channels; ++i)
+    {
+        ChannelConfig channel{"Channel " + std::to_string(i + 1)};
+        channel.pattern = PATTERNS[static_cast<std::size_t>(i / 16) % std::size(PATTERNS)];
+        channel.controller = "Controller";
+        config.channels.push_back(std::move(channel));
+    }
+    const auto link{std::make_shared<OffloadLink>(ptsname(master), BAUD, static_cast<std::size_t>(channels))};
+    config.controllers.push_back(ControllerConfig{"Controller", link});
+
+    std::vector<std::uint16_t> levels(static_cast<std::size_t>(channels));
+    OffloadReceiver receiver;
+    offload_receiver_init(&receiver, levels.data(), static_cast<std::uint16_t>(channels));
+    const auto receive{[master, &receiver]()
+                       {
+                           pollfd poller{master, POLLIN, 0};
+                           std::uint8_t buffer[4096];
+                           while (poll(&poller, 1, RECEIVE_TIMEOUT_MS) > 0)
+                           {
+                               const ssize_t count{read(master, buffer, sizeof(buffer))};
+                               for (ssize_t i{0}; i < count; ++i)
+                               {
+                                   if (offload_receiver_feed(&receiver, buffer[i]) == 1)
+                                   {
+                                       return true;
+                                   }
+                               }
+                           }
+                           return false;
+                       }};
+
+    PwmEngine engine;
+    engine.setHardwareOutput(false);
+    engine.applyConfig(std::make_shared<const RigConfig>(std::move(config)));
+    receive(); // The first keyframe
+
+    const OffloadStats before{link->stats()};
+    std::vector<double> latencies;
+    int mismatches{0};
+    for (int frame{0}; frame < frames; ++frame)
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        engine.tick();
+        if (receive())
+        {
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        for (std::size_t i{0}; i < levels.size(); ++i)
+        {
+            const Channel &channel{engine.channel(i)};
+            if (levels[i] != static_cast<std::uint16_t>(static_cast<long long>(channel.output) * 0xFFFF / channel.range))
+            {
+                ++mismatches;
+                break;
+            }
+        }
+    }
+    close(master);
+
+    const OffloadStats &after{link->stats()};
+    const double bytes{static_cast<double>(after.bytes - before.bytes) / frames};
+    const double keyframeBytes{OFFLOAD_HEADER_BYTES + 2.0 + 2.0 * channels + OFFLOAD_CRC_BYTES};
+    qInfo("%d channels: %.0f bytes/frame (keyframes only: %.0f), %.2f ms on the wire at %d baud",
+          channels, bytes, keyframeBytes, bytes * 10.0 / BAUD * 1000.0, BAUD);
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty())
+    {
+        qInfo("Frame start to receiver: median %.0f us, 99th percentile %.0f us, max %.0f us over %zu frames",
+              latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back(),
+              latencies.size());
+    }
+    qInfo("%zu keyframes, %zu dropped, %d frames with a mismatch, receiver: %u CRC errors, %u lost",
+          after.keyframes - before.keyframes, after.dropped - before.dropped, mismatches, receiver.crcErrors,
+          receiver.lost);
+}
+
+/**
+ * The producer side of runFrameRingBenchmark(), in the child process. Each
+ * frame holds consecutive levels starting at the frame number, so a frame
+ * mixed from two can be told apart.
+ */
+[[noreturn]] static void produceFrames(const char *name, int channels, int frames)
+{
+    constexpr std::chrono::microseconds INTERVAL{1000};
+    FrameRingHeader *ring{frame_ring_attach(name)};
+    if (ring == nullptr)
+    {
+        _exit(1);
+    }
+    for (int frame{1}; frame <= frames; ++frame)
+    {
+        std::uint16_t *levels{frame_ring_begin(ring)};
+        for (int i{0}; i < channels; ++i)
+        {
+            levels[i] = static_cast<std::uint16_t>(frame + i);
+        }
+        frame_ring_publish(ring, static_cast<std::uint32_t>(channels));
+        usleep(static_cast<useconds_t>(INTERVAL.count()));
+    }
+    frame_ring_detach(ring);
+    _exit(0);
+}
+
+void runFrameRingBenchmark(int channels, int frames)
+{
+    constexpr std::size_t SLOTS{4};
+    // Gives up on the producer after this long without a frame
+    constexpr std::chrono::milliseconds WAIT_TIMEOUT{500};
+    const std::string name{"/pwm-ring-bench-" + std::to_string(getpid())};
+
+    RigConfig config;
+    for (int i{0}; i < channels; ++i)
+    {
+        ChannelConfig channel{"Channel " + std::to_string(i + 1)};
+        channel.range = 0xFFFF; // Levels arrive unscaled, so the duty shows which frame they came from
+        config.channels.push_back(std::move(channel));
+    }
+    PwmEngine engine;
+    engine.setHardwareOutput(false);
+    engine.applyConfig(std::make_shared<const RigConfig>(std::move(config)));
+    engine.setFrameRing(std::make_unique<FrameRing>(name, static_cast<std::size_t>(channels), SLOTS));
+    FrameRing &ring{*engine.frameRing()};
+
+    const pid_t producer{fork()};
+    if (producer < 0)
+    {
+        throw std::runtime_error{"Cannot start the frame producer"};
+    }
+    if (producer == 0)
+    {
+        produceFrames(name.c_str(), channels, frames);
+    }
+
+    std::vector<double> latencies;
+    int mixed{0};
+    while (ring.stats().frames + ring.stats().skipped < static_cast<std::size_t>(frames) && ring.wait(WAIT_TIMEOUT))
+    {
+        engine.tick();
+        timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const std::uint64_t nowNs{static_cast<std::uint64_t>(now.tv_sec) * 1000000000u + static_cast<std::uint64_t>(now.tv_nsec)};
+        latencies.push_back(static_cast<double>(nowNs - ring.lastTimestampNs()) / 1000.0);
+        for (std::size_t i{1}; i < engine.channelCount(); ++i)
+        {
+            if (engine.channel(i).duty != static_cast<std::uint16_t>(engine.channel(0).duty + static_cast<int>(i)))
+            {
+                ++mixed;
+                break;
+            }
+        }
+    }
+    int status{0};
+    waitpid(producer, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        throw std::runtime_error{"The frame producer could not attach to " + name};
+    }
+
+    const FrameRingStats &stats{ring.stats()};
+    qInfo("%d channels: %zu frames applied, %zu skipped, %zu torn reads retried, %d mixed frames",
+          channels, stats.frames, stats.skipped, stats.torn, mixed);
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty())
+    {
+        qInfo("Publish to merged duty: median %.0f us, 99th percentile %.0f us, max %.0f us",
+              latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+    }
+}
+
+void runAmbientBenchmark(int channels, int seconds)
+{
+    constexpr int FRAME_MS{20};
+    RigConfig config;
+    config.frameIntervalMs = FRAME_MS;
+    for (int i{0}; i < channels; ++i)
+    {
+        ChannelConfig channel{"Channel " + std::to_string(i + 1)};
+        channel.zone = "Room";
+        config.channels.push_back(std::move(channel));
+    }
+    SimulatedRoom room;
+    room.period = 20.0;
+    config.ambient.sensor = std::make_shared<SimulatedLightSensor>(room);
+    config.ambient.zone = "Room";
+
+    PwmEngine engine;
+    engine.setHardwareOutput(false);
+    engine.applyConfig(std::make_shared<const RigConfig>(std::move(config)));
+    for (std::size_t i{0}; i < engine.channelCount(); ++i)
+    {
+        engine.setDuty(i, engine.channel(i).range);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const int frames{seconds * 1000 / FRAME_MS};
+    for (int frame{0}; frame < frames; ++frame)
+    {
+        engine.tick();
+    }
+    const qint64 elapsedMs{timer.elapsed()};
+
+    const AmbientStats &stats{*engine.ambientStats()};
+    qInfo("%d channels, %d s of engine time in %lld ms: %zu steps, %.2f us mean and %.1f us max per step",
+          channels, seconds, elapsedMs, stats.steps, stats.totalStepUs / static_cast<double>(std::max<std::size_t>(1, stats.steps)),
+          stats.maxStepUs);
+    qInfo("%zu daylight jumps settled within %.0f %%: last in %.1f s, slowest in %.1f s",
+          stats.settled, AmbientController::SETTLED_ERROR * 100.0, stats.lastSettleS, stats.maxSettleS);
+    qInfo("Now %.0f lux for a target of %.0f (error %+.1f %%), gain %.3f",
+          stats.lux, engine.config().ambient.target, stats.error * 100.0, stats.gain);
+}
+
+void runSlewBenchmark(int channels, int frames)
+{
+    constexpr int FRAME_MS{20};
+    constexpr int EVENT_FRAMES{5}; // A slider event every 100 ms
+    struct Run
+    {
+        const char *name;
+        int slewMs;
+        int smoothMs;
+    };
+    constexpr Run RUNS[]{{"instant", 0, 0}, {"slew 500 ms", 500, 0}, {"smooth 150 ms", 0, 150}};
+
+    for (const Run &run : RUNS)
+    {
+        RigConfig config;
+        config.frameIntervalMs = FRAME_MS;
+        for (int i{0}; i < channels; ++i)
+        {
+            ChannelConfig channel{"Channel " + std::to_string(i + 1)};
+            channel.range = 1000;
+            channel.slewMs = run.slewMs;
+            channel.smoothMs = run.smoothMs;
+            config.channels.push_back(std::move(channel));
+        }
+        PwmEngine engine;
+        engine.setHardwareOutput(false);
+        engine.applyConfig(std::make_shared<const RigConfig>(std::move(config)));
+
+        std::minstd_rand random{1}; // Same events for every run
+        std::uniform_int_distribution<int> level{0, 1000};
+        std::vector<int> previous;
+        std::vector<int> outputs;
+        engine.snapshotOutputs(previous);
+        int largestStep{0};
+        qint64 elapsedNs{0};
+        for (int frame{0}; frame < frames; ++frame)
+        {
+            if (frame % EVENT_FRAMES == 0)
+            {
+                for (std::size_t i{0}; i < engine.channelCount(); ++i)
+                {
+                    engine.setDuty(i, level(random));
+                }
+            }
+            QElapsedTimer timer;
+            timer.start();
+            engine.tick();
+            elapsedNs += timer.nsecsElapsed();
+
+            engine.snapshotOutputs(outputs);
+            for (std::size_t i{0}; i < outputs.size(); ++i)
+            {
+                largestStep = std::max(largestStep, std::abs(outputs[i] - previous[i]));
+            }
+            previous.swap(outputs);
+        }
+        qInfo("%-14s %d channels: %.1f us/frame, largest step per frame %.1f %% of range", run.name, channels,
+              static_cast<double>(elapsedNs) / frames / 1000.0, largestStep / 10.0);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/**
+ * Times the addressable strip encoders on a strip of leds LEDs, alone and
+ * with the frame filled and written to /dev/null, and prints the
+ * throughput in LEDs per millisecond for each chip. Clocked chips have no
+ * encoding step, so they are only timed with the write.
+ */
+void runStripBenchmark(int leds, int frames);
+
+/**
+ * Runs a rig of channels on file-backed PCA9685 fakes in /tmp, 16 per
+ * board with a different pattern mix on each, and prints the I2C
+ * transfers, messages and bytes per frame.
+ */
+void runExpanderBenchmark(int channels, int frames);
+
+/**
+ * Streams a rig of channels through a pseudo-terminal pair to the
+ * reference receiver, checks every frame it decodes, and prints bytes per
+ * frame, wire time at 921600 baud and the latency from the start of the
+ * engine frame to the receiver applying it.
+ */
+void runOffloadBenchmark(int channels, int frames);
+
+/**
+ * Forks a producer that publishes frames of channels levels into a frame
+ * ring, one every millisecond, while an engine sleeps on the ring and
+ * applies each frame in a tick. Prints the latency from publishing to the
+ * merged duty, frames skipped and torn reads retried, and checks that no
+ * tick applied a mix of two frames.
+ */
+void runFrameRingBenchmark(int channels, int frames);
+
+/**
+ * Runs the ambient light loop on a zone of channels in a simulated room
+ * whose daylight jumps every half period, for seconds of engine time as
+ * fast as possible, and prints how long the steps took, how quickly the
+ * loop settled after each jump and the error it was left with.
+ */
+void runAmbientBenchmark(int channels, int seconds);
+
+/**
+ * Moves channels to random levels every few frames, like slider events at
+ * 10 Hz, with instant outputs, a slew limit and exponential smoothing, and
+ * prints the time per frame and the largest output step a frame made.
+ */
+void runSlewBenchmark(int channels, int frames);
@@ -0,0 +1,277 @@
+#include "pca9685.h"
+
+#include <algorithm>        // std::min
+#include <chrono>           // Oscillator start-up wait
+#include <cstring>          // std::memcpy
+#include <fcntl.h>          // open
+#include <linux/i2c-dev.h>  // I2C_RDWR, I2C_SLAVE, I2C_SMBUS
+#include <linux/i2c.h>      // i2c_msg, I2C_FUNC_*
+#include <stdexcept>        // std::runtime_error
+#include <sys/ioctl.h>      // ioctl
+#include <sys/stat.h>       // fstat
+#include <thread>           // Oscillator start-up wait
+#include <unistd.h>         // pwrite, pread, close
+#include <vector>           // Transfer buffers
+
+// Registers and bits (datasheet section 7.3)
+constexpr std::uint8_t MODE1{0x00};
+constexpr std::uint8_t MODE2{0x01};
+constexpr std::uint8_t LED0_ON_L{0x06};
+constexpr std::uint8_t ALL_LED_ON_L{0xFA};
+constexpr std::uint8_t PRE_SCALE{0xFE};
+constexpr std::uint8_t MODE1_AI{0x20};     // Register auto-increment
+constexpr std::uint8_t MODE1_SLEEP{0x10};  // Oscillator off, needed to change PRE_SCALE
+constexpr std::uint8_t MODE2_OUTDRV{0x04}; // Totem-pole outputs; OCH clear = latch on STOP
+constexpr std::uint8_t FULL_BIT{0x10};     // Bit 4 of LEDn_ON_H / LEDn_OFF_H
+constexpr int OSCILLATOR_HZ{25000000};
+// Largest SMBus I2C block write
+constexpr std::size_t SMBUS_BLOCK_BYTES{32};
+
+/**
+ * The ON/OFF counts of one output. Each output turns on at its own phase
+ * so the 16 do not all switch at once; 0 and full range use the full-off
+ * and full-on bits.
+ */
+static void encodeOutput(std::uint8_t *registers, std::size_t output, int level, int range)
+{
+    const auto on{static_cast<unsigned>(output * PCA9685_STEPS / PCA9685_OUTPUTS)};
+    const auto count{static_cast<unsigned>(static_cast<long long>(level) * PCA9685_STEPS / range)};
+    const unsigned off{(on + count) % PCA9685_STEPS};
+    registers[0] = static_cast<std::uint8_t>(on & 0xFF);
+    registers[1] = static_cast<std::uint8_t>(on >> 8 | (level >= range ? FULL_BIT : 0));
+    registers[2] = static_cast<std::uint8_t>(off & 0xFF);
+    registers[3] = static_cast<std::uint8_t>(off >> 8 | (level <= 0 ? FULL_BIT : 0));
+}
+
+Pca9685::Pca9685(const std::string &device, int address, int frequency)
+    : m_device{device}, m_address{address}, m_frequency{frequency}
+{
+    // Only fake boards are created; a mistyped /dev path must not become one
+    const bool devicePath{device.rfind("/dev/", 0) == 0};
+    m_fd = open(device.c_str(), O_RDWR | O_CLOEXEC | (devicePath ? 0 : O_CREAT), 0644);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error{"Cannot open expander device " + device};
+    }
+
+    struct stat info{};
+    fstat(m_fd, &info);
+    unsigned long functions{0};
+    if (devicePath || !S_ISREG(info.st_mode))
+    {
+        if (ioctl(m_fd, I2C_FUNCS, &functions) < 0 || ioctl(m_fd, I2C_SLAVE, address) < 0)
+        {
+            close(m_fd);
+            throw std::runtime_error{device + " is not an I2C bus"};
+        }
+        m_bus = (functions & I2C_FUNC_I2C) != 0 ? Bus::I2c : Bus::Smbus;
+    }
+
+    // Changing the frequency needs the oscillator stopped, which turns the
+    // outputs off, so it is only done if the chip runs at another one
+    const auto prescale{static_cast<std::uint8_t>((OSCILLATOR_HZ + PCA9685_STEPS * frequency / 2) /
+                                                  (PCA9685_STEPS * frequency) - 1)};
+    const std::uint8_t mode1{MODE1_AI};
+    const std::uint8_t mode2{MODE2_OUTDRV};
+    std::uint8_t current{0};
+    bool ok{readRegister(PRE_SCALE, current)};
+    if (ok && current != prescale)
+    {
+        const std::uint8_t sleep{MODE1_AI | MODE1_SLEEP};
+        ok = writeRegisters(MODE1, &sleep, 1) && writeRegisters(PRE_SCALE, &prescale, 1);
+    }
+    ok = ok && writeRegisters(MODE1, &mode1, 1) && writeRegisters(MODE2, &mode2, 1);
+    if (!ok)
+    {
+        close(m_fd);
+        throw std::runtime_error{"No PCA9685 answers at address " + std::to_string(address) + " on " + device};
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds{500}); // Oscillator start-up
+    m_stats = ExpanderStats{}; // Only frame traffic is reported
+
+    // Every output starts off in the image and is sent with the first
+    // flush, by when the engine has set the ones it drives
+    for (std::size_t output{0}; output < PCA9685_OUTPUTS; ++output)
+    {
+        setOutput(output, 0, 1);
+    }
+}
+
+Pca9685::~Pca9685()
+{
+    close(m_fd);
+}
+
+void Pca9685::setOutput(std::size_t output, int level, int range)
+{
+    encodeOutput(m_leds.data() + 4 * output, output, level, range);
+    m_changed |= 1u << output;
+}
+
+/**
+ * Turns all 16 outputs off with one write to the ALL_LED registers.
+ */
+void Pca9685::allOff()
+{
+    const std::uint8_t off[4]{0, 0, 0, FULL_BIT};
+    writeRegisters(ALL_LED_ON_L, off, sizeof(off));
+    for (std::size_t output{0}; output < PCA9685_OUTPUTS; ++output)
+    {
+        encodeOutput(m_leds.data() + 4 * output, output, 0, 1);
+    }
+    m_changed = 0;
+}
+
+bool Pca9685::flush()
+{
+    if (m_changed == 0)
+    {
+        return true;
+    }
+    const bool sent{sendRuns()};
+    m_changed = 0;
+    ++m_stats.frames;
+    return sent;
+}
+
+/**
+ * Sends every run of adjacent changed outputs as one auto-increment write,
+ * all in one transfer where the bus allows it.
+ */
+bool Pca9685::sendRuns()
+{
+    struct Run
+    {
+        std::uint8_t reg;
+        const std::uint8_t *data;
+        std::size_t count;
+    };
+    Run runs[PCA9685_OUTPUTS / 2];
+    std::size_t runCount{0};
+    for (std::size_t output{0}; output < PCA9685_OUTPUTS;)
+    {
+        if ((m_changed >> output & 1) == 0)
+        {
+            ++output;
+            continue;
+        }
+        const std::size_t first{output};
+        while (output < PCA9685_OUTPUTS && (m_changed >> output & 1) != 0)
+        {
+            ++output;
+        }
+        m_stats.outputs += output - first;
+        runs[runCount++] = Run{static_cast<std::uint8_t>(LED0_ON_L + 4 * first), m_leds.data() + 4 * first,
+                               4 * (output - first)};
+    }
+
+    if (m_bus == Bus::Smbus)
+    {
+        bool ok{true};
+        for (std::size_t i{0}; i < runCount; ++i)
+        {
+            ok = writeRegisters(runs[i].reg, runs[i].data, runs[i].count) && ok;
+        }
+        return ok;
+    }
+
+    ++m_stats.transfers;
+    m_stats.messages += runCount;
+    if (m_bus == Bus::File)
+    {
+        // Counted as the combined transfer the real bus would get
+        bool ok{true};
+        for (std::size_t i{0}; i < runCount; ++i)
+        {
+            m_stats.bytes += runs[i].count + 2;
+            ok = pwrite(m_fd, runs[i].data, runs[i].count, runs[i].reg) == static_cast<ssize_t>(runs[i].count) && ok;
+        }
+        return ok;
+    }
+
+    // One message per run; the adapter puts a repeated START between them
+    // and a single STOP at the end, where the chip latches all of them
+    std::uint8_t buffers[PCA9685_OUTPUTS / 2][1 + PCA9685_OUTPUTS * 4];
+    i2c_msg messages[PCA9685_OUTPUTS / 2];
+    for (std::size_t i{0}; i < runCount; ++i)
+    {
+        buffers[i][0] = runs[i].reg;
+        std::memcpy(buffers[i] + 1, runs[i].data, runs[i].count);
+        messages[i] = i2c_msg{static_cast<__u16>(m_address), 0, static_cast<__u16>(runs[i].count + 1), buffers[i]};
+        m_stats.bytes += runs[i].count + 2;
+    }
+    i2c_rdwr_ioctl_data transfer{messages, static_cast<__u32>(runCount)};
+    return ioctl(m_fd, I2C_RDWR, &transfer) >= 0;
+}
+
+/**
+ * Writes count consecutive registers as one transfer (SMBus: one per 32
+ * bytes). Counts the traffic in the stats.
+ */
+bool Pca9685::writeRegisters(std::uint8_t reg, const std::uint8_t *data, std::size_t count)
+{
+    switch (m_bus)
+    {
+    case Bus::File:
+        ++m_stats.transfers;
+        ++m_stats.messages;
+        m_stats.bytes += count + 2;
+        return pwrite(m_fd, data, count, reg) == static_cast<ssize_t>(count);
+    case Bus::I2c:
+    {
+        std::vector<std::uint8_t> buffer(count + 1);
+        buffer[0] = reg;
+        std::memcpy(buffer.data() + 1, data, count);
+        i2c_msg message{static_cast<__u16>(m_address), 0, static_cast<__u16>(buffer.size()), buffer.data()};
+        i2c_rdwr_ioctl_data transfer{&message, 1};
+        ++m_stats.transfers;
+        ++m_stats.messages;
+        m_stats.bytes += count + 2;
+        return ioctl(m_fd, I2C_RDWR, &transfer) >= 0;
+    }
+    case Bus::Smbus:
+        for (std::size_t done{0}; done < count; done += SMBUS_BLOCK_BYTES)
+        {
+            const std::size_t size{std::min(SMBUS_BLOCK_BYTES, count - done)};
+            i2c_smbus_data block{};
+            block.block[0] = static_cast<__u8>(size);
+            std::memcpy(block.block + 1, data + done, size);
+            i2c_smbus_ioctl_data args{I2C_SMBUS_WRITE, static_cast<__u8>(reg + done), I2C_SMBUS_I2C_BLOCK_DATA, &block};
+            ++m_stats.transfers;
+            ++m_stats.messages;
+            m_stats.bytes += size + 2;
+            if (ioctl(m_fd, I2C_SMBUS, &args) < 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool Pca9685::readRegister(std::uint8_t reg, std::uint8_t &value)
+{
+    switch (m_bus)
+    {
+    case Bus::File:
+        value = 0;
+        return pread(m_fd, &value, 1, reg) >= 0; // A new file reads as empty
+    case Bus::I2c:
+    {
+        i2c_msg messages[2]{{static_cast<__u16>(m_address), 0, 1, &reg},
+                            {static_cast<__u16>(m_address), I2C_M_RD, 1, &value}};
+        i2c_rdwr_ioctl_data transfer{messages, 2};
+        return ioctl(m_fd, I2C_RDWR, &transfer) >= 0;
+    }
+    case Bus::Smbus:
+    {
+        i2c_smbus_data data{};
+        i2c_smbus_ioctl_data args{I2C_SMBUS_READ, reg, I2C_SMBUS_BYTE_DATA, &data};
+        const bool ok{ioctl(m_fd, I2C_SMBUS, &args) >= 0};
+        value = data.byte;
+        return ok;
+    }
+    }
+    return false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>   // Register image
+#include <cstddef> // std::size_t
+#include <cstdint> // Register bytes
+#include <string>  // Device path
+
+// Outputs of one PCA9685 and the steps of its 12-bit PWM
+constexpr std::size_t PCA9685_OUTPUTS{16};
+constexpr int PCA9685_STEPS{4096};
+// Address with all address pins low
+constexpr int PCA9685_DEFAULT_ADDRESS{0x40};
+// PWM frequency limits of the internal 25 MHz oscillator
+constexpr int PCA9685_MIN_HZ{24};
+constexpr int PCA9685_MAX_HZ{1526};
+
+// Bus traffic of an expander since it was opened
+struct ExpanderStats
+{
+    std::size_t frames{0};    // Flushes that sent something
+    std::size_t transfers{0}; // Bus transfers, each ending with one STOP
+    std::size_t messages{0};  // Auto-increment register writes
+    std::size_t outputs{0};   // Outputs sent, i.e. messages without batching
+    std::size_t bytes{0};     // Bytes on the bus, address bytes included
+};
+
+/**
+ * A PCA9685 16-channel PWM expander on an I2C bus (/dev/i2c-N).
+ *
+ * setOutput() only updates a local image of the LED registers. flush()
+ * sends the outputs changed since the last flush: each run of adjacent
+ * changed outputs becomes one auto-increment write, and all runs of the
+ * board go out as one combined transfer (repeated START between them).
+ * With MODE2.OCH clear the chip latches new values at the STOP, so all
+ * 16 outputs change together without blanking them through OE.
+ *
+ * Adapters that only speak SMBus, such as the i2c-stub test module, get
+ * the runs as I2C block writes of up to 32 bytes instead, which then latch
+ * one block at a time. A regular file outside /dev is a fake device: it
+ * holds the register image at the register offsets and can be inspected
+ * with xxd. A path in /dev must be an existing I2C bus.
+ */
+class Pca9685
+{
+public:
+    // Opens the device and sets up the chip; throws std::runtime_error on failure
+    Pca9685(const std::string &device, int address, int frequency);
+    ~Pca9685();
+
+    Pca9685(const Pca9685 &) = delete;
+    Pca9685 &operator=(const Pca9685 &) = delete;
+
+    // Sets an output to level / range; sent by the next flush()
+    void setOutput(std::size_t output, int level, int range);
+    // Turns every output off at once
+    void allOff();
+
+    // Sends the changed outputs; false if the bus rejected the transfer
+    bool flush();
+
+    const std::string &device() const { return m_device; }
+    int address() const { return m_address; }
+    int frequency() const { return m_frequency; }
+    const ExpanderStats &stats() const { return m_stats; }
+
+private:
+    enum class Bus
+    {
+        I2c,   // Combined I2C_RDWR transfers
+        Smbus, // I2C block writes only
+        File   // Register image in a regular file
+    };
+
+    bool writeRegisters(std::uint8_t reg, const std::uint8_t *data, std::size_t count);
+    bool readRegister(std::uint8_t reg, std::uint8_t &value);
+    bool sendRuns();
+
+    std::string m_device;
+    int m_address;
+    int m_frequency;
+    int m_fd{-1};
+    Bus m_bus{Bus::File};
+    std::array<std::uint8_t, PCA9685_OUTPUTS * 4> m_leds{}; // LEDn_ON_L .. LEDn_OFF_H
+    std::uint32_t m_changed{0};                             // One bit per output
+    ExpanderStats m_stats;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>   // Fixed-size channel table
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t colors
+#include "rig_config.h"
+
+/**
+ * Compile-time description of the built-in rig, plus the pin rules that
+ * both this table and configuration files are checked against.
+ */
+
+// pigpio can drive software PWM on the user GPIOs 0–31
+constexpr bool isPwmCapablePin(int pin)
+{
+    return pin >= 0 && pin <= 31;
+}
+
+// GPIO 12/18 are wired to PWM channel 0 and GPIO 13/19 to PWM channel 1
+constexpr bool isHardwarePwmPin(int pin)
+{
+    return pin == 12 || pin == 13 || pin == 18 || pin == 19;
+}
+
+constexpr int hardwarePwmChannel(int pin)
+{
+    return (pin == 12 || pin == 18) ? 0 : 1;
+}
+
+/**
+ * One entry of the built-in pin map.
+ */
+struct ChannelDescriptor
+{
+    const char *name;
+    int gpioPin;
+    std::uint32_t color;
+    Pattern pattern;
+    bool inverted{false};    // Fade: see-saw partner
+    bool hardwarePwm{false}; // Use the PWM peripheral instead of pigpio's DMA PWM
+};
+
+constexpr std::array<ChannelDescriptor, 3> DEFAULT_CHANNELS{{
+    {"Red LED", 17, 0xFF0000, Pattern::Manual},
+    {"Green LED", 27, 0x00FF00, Pattern::Fade},
+    {"Blue LED", 22, 0x0000FF, Pattern::Fade, true},
+}};
+
+template <std::size_t N>
+constexpr bool hasDuplicatePins(const std::array<ChannelDescriptor, N> &channels)
+{
+    for (std::size_t i{0}; i < N; ++i)
+    {
+        for (std::size_t j{i + 1}; j < N; ++j)
+        {
+            if (channels[i].gpioPin == channels[j].gpioPin)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+template <std::size_t N>
+constexpr bool allPinsPwmCapable(const std::array<ChannelDescriptor, N> &channels)
+{
+    for (const ChannelDescriptor &channel : channels)
+    {
+        if (!isPwmCapablePin(channel.gpioPin))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hardware PWM needs a PWM pin, and each of the two PWM channels can only
+// drive one output of ours (12/18 and 13/19 would mirror each other)
+template <std::size_t N>
+constexpr bool hardwarePwmValid(const std::array<ChannelDescriptor, N> &channels)
+{
+    bool used[2]{false, false};
+    for (const ChannelDescriptor &channel : channels)
+    {
+        if (!channel.hardwarePwm)
+        {
+            continue;
+        }
+        if (!isHardwarePwmPin(channel.gpioPin) || used[hardwarePwmChannel(channel.gpioPin)])
+        {
+            return false;
+        }
+        used[hardwarePwmChannel(channel.gpioPin)] = true;
+    }
+    return true;
+}
+
+static_assert(!hasDuplicatePins(DEFAULT_CHANNELS), "Two channels share a GPIO pin");
+static_assert(allPinsPwmCapable(DEFAULT_CHANNELS), "Channel on a GPIO without PWM support");
+static_assert(hardwarePwmValid(DEFAULT_CHANNELS), "Hardware PWM requested on an ineligible or shared pin");
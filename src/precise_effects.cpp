@@ -0,0 +1,234 @@
+#include "precise_effects.h"
+
+#include <algorithm> // std::sort
+#include <pthread.h> // Real-time priority for the timing thread
+#include <QtGlobal>  // qInfo
+#include <time.h>    // clock_nanosleep, clock_gettime
+#include <utility>   // std::move
+
+// Edges recorded when the effect has no edge limit; later edges are not recorded
+constexpr std::size_t MAX_RECORDED_EDGES{100000};
+// The thread sleeps until this long before a deadline and busy-waits the rest
+constexpr std::int64_t SPIN_NS{200000};
+// Longest single sleep, so stop() is never held up by a slow strobe
+constexpr std::int64_t MAX_SLEEP_NS{10000000};
+// Time from start() to the first edge, so the thread is settled when it comes
+constexpr std::int64_t START_DELAY_NS{2000000};
+// SCHED_FIFO priority of the timing thread, when the process may use it
+constexpr int TIMING_PRIORITY{50};
+
+static std::int64_t nowNs()
+{
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+PreciseEffects::PreciseEffects(PwmEngine &engine)
+    : m_engine{engine}
+{
+    m_outputListenerId = m_engine.addOutputListener([this](std::size_t index)
+                                                    { onOutputChanged(index); });
+    // Channel indices and pins are about to change
+    m_layoutListenerId = m_engine.addLayoutListener([this](bool rebuilt)
+                                                    {
+        if (!rebuilt) {
+            stop();
+        } });
+}
+
+PreciseEffects::~PreciseEffects()
+{
+    stop();
+    m_engine.removeOutputListener(m_outputListenerId);
+    m_engine.removeLayoutListener(m_layoutListenerId);
+}
+
+void PreciseEffects::startStrobe(std::vector<std::size_t> channels, Duration onTime, Duration offTime,
+                                 std::size_t edgeLimit)
+{
+    start(Mode::Strobe, std::move(channels), std::chrono::nanoseconds{onTime}.count(),
+          std::chrono::nanoseconds{offTime}.count(), edgeLimit);
+}
+
+void PreciseEffects::startChase(std::vector<std::size_t> channels, Duration stepTime, std::size_t edgeLimit)
+{
+    start(Mode::Chase, std::move(channels), std::chrono::nanoseconds{stepTime}.count(), 0, edgeLimit);
+}
+
+/**
+ * Claims the channels from the engine, takes their current outputs as the
+ * "on" levels and starts the timing thread. Real-time scheduling is asked
+ * for but not required; without it the edge errors simply get larger.
+ */
+void PreciseEffects::start(Mode mode, std::vector<std::size_t> channels, std::int64_t firstNs,
+                           std::int64_t secondNs, std::size_t edgeLimit)
+{
+    stop();
+    if (channels.empty() || firstNs <= 0)
+    {
+        return;
+    }
+
+    m_mode = mode;
+    m_channels = std::move(channels);
+    m_onLevels = std::make_unique<std::atomic<int>[]>(m_channels.size());
+    for (std::size_t slot{0}; slot < m_channels.size(); ++slot)
+    {
+        m_onLevels[slot].store(m_engine.channel(m_channels[slot]).output, std::memory_order_relaxed);
+        m_engine.claimPin(m_channels[slot]);
+    }
+    m_firstNs = firstNs;
+    m_secondNs = secondNs;
+    m_edgeLimit = edgeLimit;
+    m_edgeErrorsNs.clear();
+    m_edgeErrorsNs.reserve(edgeLimit > 0 ? edgeLimit : MAX_RECORDED_EDGES);
+
+    m_running = true;
+    m_thread = std::thread{&PreciseEffects::run, this};
+
+    sched_param param{};
+    param.sched_priority = TIMING_PRIORITY;
+    pthread_setschedparam(m_thread.native_handle(), SCHED_FIFO, &param);
+}
+
+void PreciseEffects::stop()
+{
+    m_running = false;
+    wait();
+}
+
+void PreciseEffects::wait()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    m_thread.join();
+    m_running = false;
+    for (std::size_t index : m_channels)
+    {
+        m_engine.releasePin(index);
+    }
+    m_channels.clear();
+}
+
+/**
+ * The timing thread. Edge n of a strobe is due at start + n/2 periods (plus
+ * the on time for odd edges); edge n of a chase at start + n steps.
+ */
+void PreciseEffects::run()
+{
+    if (m_mode == Mode::Chase)
+    {
+        for (std::size_t slot{0}; slot < m_channels.size(); ++slot)
+        {
+            writeEdge(slot, false);
+        }
+    }
+
+    const std::int64_t startNs{nowNs() + START_DELAY_NS};
+    for (std::size_t edge{0}; m_edgeLimit == 0 || edge < m_edgeLimit; ++edge)
+    {
+        std::int64_t deadlineNs{0};
+        if (m_mode == Mode::Strobe)
+        {
+            const auto cycle{static_cast<std::int64_t>(edge / 2)};
+            deadlineNs = startNs + cycle * (m_firstNs + m_secondNs) + (edge % 2 != 0 ? m_firstNs : 0);
+        }
+        else
+        {
+            deadlineNs = startNs + static_cast<std::int64_t>(edge) * m_firstNs;
+        }
+
+        waitUntil(deadlineNs);
+        if (!m_running.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        if (m_mode == Mode::Strobe)
+        {
+            for (std::size_t slot{0}; slot < m_channels.size(); ++slot)
+            {
+                writeEdge(slot, edge % 2 == 0);
+            }
+        }
+        else
+        {
+            if (edge > 0)
+            {
+                writeEdge((edge - 1) % m_channels.size(), false);
+            }
+            writeEdge(edge % m_channels.size(), true);
+        }
+
+        if (m_edgeErrorsNs.size() < m_edgeErrorsNs.capacity())
+        {
+            m_edgeErrorsNs.push_back(nowNs() - deadlineNs);
+        }
+    }
+}
+
+/**
+ * Sleeps on absolute deadlines until SPIN_NS before deadlineNs, then spins.
+ * Returns early if the effect is stopped.
+ */
+void PreciseEffects::waitUntil(std::int64_t deadlineNs) const
+{
+    for (std::int64_t now{nowNs()}; deadlineNs - now > SPIN_NS; now = nowNs())
+    {
+        if (!m_running.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        const std::int64_t wakeNs{std::min(deadlineNs - SPIN_NS, now + MAX_SLEEP_NS)};
+        const timespec wake{static_cast<time_t>(wakeNs / 1000000000), static_cast<long>(wakeNs % 1000000000)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr);
+    }
+    while (nowNs() < deadlineNs)
+    {
+    }
+}
+
+void PreciseEffects::writeEdge(std::size_t slot, bool on)
+{
+    m_engine.writeOutput(m_channels[slot], on ? m_onLevels[slot].load(std::memory_order_relaxed) : 0);
+}
+
+/**
+ * Follows the engine output of the claimed channels, so sliders and faders
+ * still set the strobe level.
+ */
+void PreciseEffects::onOutputChanged(std::size_t index)
+{
+    if (!m_onLevels)
+    {
+        return;
+    }
+    for (std::size_t slot{0}; slot < m_channels.size(); ++slot)
+    {
+        if (m_channels[slot] == index)
+        {
+            m_onLevels[slot].store(m_engine.channel(index).output, std::memory_order_relaxed);
+        }
+    }
+}
+
+void PreciseEffects::reportEdgeErrors() const
+{
+    if (m_edgeErrorsNs.empty())
+    {
+        qInfo("No edges recorded");
+        return;
+    }
+
+    std::vector<std::int64_t> sorted{m_edgeErrorsNs};
+    std::sort(sorted.begin(), sorted.end());
+
+    const auto at{[&sorted](double q)
+                  { return static_cast<double>(sorted[static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1))]) / 1000.0; }};
+    qInfo("Edge lateness over %zu edges: min %.1f us, median %.1f us, p99 %.1f us, max %.1f us",
+          sorted.size(), at(0.0), at(0.5), at(0.99), at(1.0));
+}
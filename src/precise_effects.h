@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>  // Running flag and on-levels shared with the timing thread
+#include <chrono>  // Edge periods
+#include <cstddef> // std::size_t
+#include <cstdint> // Nanosecond timestamps
+#include <memory>  // Per-channel atomic levels
+#include <thread>  // Timing thread
+#include <vector>  // Channel lists and recorded edge errors
+#include "pwm_engine.h"
+
+/**
+ * Strobes and chases whose edges are far tighter than the engine's frame
+ * timer. A dedicated thread sleeps until an absolute CLOCK_MONOTONIC
+ * deadline (clock_nanosleep with TIMER_ABSTIME), busy-waits the last
+ * stretch, and writes the pins itself. Deadlines are computed from the
+ * start time, so errors never accumulate from edge to edge.
+ *
+ * While an effect runs, its channels are claimed from the engine: the
+ * engine keeps computing their output (slider, faders, ...), which becomes
+ * the "on" level, but leaves the pin to the effect. The effect stops when
+ * the channel list is rebuilt.
+ *
+ * The lateness of every edge (time after the pin write returned minus its
+ * deadline) is recorded. With GPIO output disabled this measures the
+ * scheduling alone; on hardware it includes the pigpio call.
+ */
+class PreciseEffects
+{
+public:
+    using Duration = std::chrono::microseconds;
+
+    explicit PreciseEffects(PwmEngine &engine);
+    ~PreciseEffects();
+
+    PreciseEffects(const PreciseEffects &) = delete;
+    PreciseEffects &operator=(const PreciseEffects &) = delete;
+
+    // All channels flash together: on for onTime, then off for offTime.
+    // edgeLimit > 0 ends the effect after that many edges.
+    void startStrobe(std::vector<std::size_t> channels, Duration onTime, Duration offTime,
+                     std::size_t edgeLimit = 0);
+
+    // One channel at a time is on, moving to the next every stepTime
+    void startChase(std::vector<std::size_t> channels, Duration stepTime, std::size_t edgeLimit = 0);
+
+    // Stops the effect and hands the pins back to the engine
+    void stop();
+
+    // Blocks until an effect with an edge limit has finished, then stops it
+    void wait();
+
+    bool running() const { return m_thread.joinable(); }
+
+    // Prints edge lateness percentiles of the last effect (call when stopped)
+    void reportEdgeErrors() const;
+
+private:
+    enum class Mode
+    {
+        Strobe,
+        Chase
+    };
+
+    void start(Mode mode, std::vector<std::size_t> channels, std::int64_t firstNs, std::int64_t secondNs,
+               std::size_t edgeLimit);
+    void run();
+    void waitUntil(std::int64_t deadlineNs) const;
+    void writeEdge(std::size_t slot, bool on);
+    void onOutputChanged(std::size_t index);
+
+    PwmEngine &m_engine;
+    PwmEngine::ListenerId m_outputListenerId{};
+    PwmEngine::ListenerId m_layoutListenerId{};
+
+    // Settings of the running effect, fixed while the thread runs
+    Mode m_mode{Mode::Strobe};
+    std::vector<std::size_t> m_channels;
+    std::unique_ptr<std::atomic<int>[]> m_onLevels; // Engine output of each channel, the "on" duty
+    std::int64_t m_firstNs{0};  // Strobe: on time; chase: step time
+    std::int64_t m_secondNs{0}; // Strobe: off time
+    std::size_t m_edgeLimit{0};
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::vector<std::int64_t> m_edgeErrorsNs; // Reserved up front; written by the thread only
+};
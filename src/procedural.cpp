@@ -0,0 +1,109 @@
+#include "procedural.h"
+
+Pcg32::Pcg32(std::uint64_t seed, std::uint64_t stream)
+    : m_state{0}, m_increment{(stream << 1) | 1}
+{
+    next();
+    m_state += seed;
+    next();
+}
+
+/**
+ * Perlin-style gradient noise: a random slope at every lattice point,
+ * blended with the 6t^5 - 15t^4 + 10t^3 fade curve. Only polynomials are
+ * used, and the result is stretched to fill the full 16-bit range.
+ */
+static std::array<std::uint16_t, NOISE_TABLE_SIZE> buildNoiseTable()
+{
+    constexpr std::size_t CELLS{NOISE_TABLE_SIZE / NOISE_CELL_SIZE};
+    Pcg32 rng{0x5EED, 0};
+    std::array<double, CELLS> gradients{};
+    for (double &gradient : gradients)
+    {
+        gradient = static_cast<double>(rng.next()) / 2147483648.0 - 1.0; // -1..1
+    }
+
+    std::array<double, NOISE_TABLE_SIZE> raw{};
+    double low{0.0};
+    double high{0.0};
+    for (std::size_t i{0}; i < NOISE_TABLE_SIZE; ++i)
+    {
+        const std::size_t cell{i / NOISE_CELL_SIZE};
+        const double t{static_cast<double>(i % NOISE_CELL_SIZE) / NOISE_CELL_SIZE};
+        const double fade{t * t * t * (t * (t * 6.0 - 15.0) + 10.0)};
+        const double left{gradients[cell] * t};
+        const double right{gradients[(cell + 1) % CELLS] * (t - 1.0)};
+        raw[i] = left + (right - left) * fade;
+        low = raw[i] < low ? raw[i] : low;
+        high = raw[i] > high ? raw[i] : high;
+    }
+
+    std::array<std::uint16_t, NOISE_TABLE_SIZE> table{};
+    for (std::size_t i{0}; i < NOISE_TABLE_SIZE; ++i)
+    {
+        table[i] = static_cast<std::uint16_t>((raw[i] - low) / (high - low) * PROCEDURAL_FULL);
+    }
+    return table;
+}
+
+const std::array<std::uint16_t, NOISE_TABLE_SIZE> &noiseTable()
+{
+    static const std::array<std::uint16_t, NOISE_TABLE_SIZE> table{buildNoiseTable()};
+    return table;
+}
+
+// Table sample at a 24.8 position
+static std::uint32_t noiseAt(std::uint32_t phase)
+{
+    return noiseTable()[(phase >> 8) & (NOISE_TABLE_SIZE - 1)];
+}
+
+ProceduralState makeProceduralState(std::uint32_t seed, std::size_t channel)
+{
+    ProceduralState state;
+    state.rng = Pcg32{seed, channel};
+    state.phase = state.rng.nextBelow(NOISE_TABLE_SIZE) << 8;
+    return state;
+}
+
+/**
+ * 75–100 % following the noise; about one frame in 48 drops to half, as if
+ * the wick caught a draught. speed 1 moves one table sample per frame.
+ */
+std::uint32_t flickerLevel(ProceduralState &state, int speed)
+{
+    state.phase += static_cast<std::uint32_t>(speed) << 8;
+    std::uint32_t level{PROCEDURAL_FULL - PROCEDURAL_FULL / 4 + noiseAt(state.phase) / 4};
+    if (state.rng.nextBelow(48) == 0)
+    {
+        level /= 2;
+    }
+    return level;
+}
+
+/**
+ * 20–100 %: a slow octave plus a faster one at three times the rate and
+ * half the weight, squared so the peaks flare.
+ */
+std::uint32_t fireLevel(ProceduralState &state, int speed)
+{
+    state.phase += static_cast<std::uint32_t>(speed) << 8;
+    const std::uint32_t mixed{(noiseAt(state.phase) * 2 + noiseAt(state.phase * 3 + (NOISE_TABLE_SIZE << 7))) / 3};
+    const std::uint32_t flare{mixed * mixed / PROCEDURAL_FULL};
+    return PROCEDURAL_FULL / 5 + flare * 4 / 5;
+}
+
+/**
+ * 8 % glow. Every frame a sparkle starts with a chance of speed in 256;
+ * a running sparkle loses an eighth of its level per frame.
+ */
+std::uint32_t twinkleLevel(ProceduralState &state, int speed)
+{
+    state.sparkle -= state.sparkle >> 3;
+    if (state.rng.nextBelow(256) < static_cast<std::uint32_t>(speed))
+    {
+        state.sparkle = PROCEDURAL_FULL;
+    }
+    constexpr std::uint32_t GLOW{PROCEDURAL_FULL * 8 / 100};
+    return GLOW + state.sparkle * (PROCEDURAL_FULL - GLOW) / PROCEDURAL_FULL;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>   // Noise table
+#include <cstddef> // std::size_t
+#include <cstdint> // Fixed-point levels and generator state
+
+/**
+ * PCG32 (XSH RR variant): a small, fast, seedable generator for lighting
+ * effects. Not suitable for anything security related.
+ */
+class Pcg32
+{
+public:
+    Pcg32() = default;
+    Pcg32(std::uint64_t seed, std::uint64_t stream);
+
+    std::uint32_t next()
+    {
+        const std::uint64_t old{m_state};
+        m_state = old * 6364136223846793005ULL + m_increment;
+        const auto xorShifted{static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27)};
+        const auto rotation{static_cast<std::uint32_t>(old >> 59)};
+        return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+    }
+
+    // A value in [0, bound), by multiply-shift instead of a division
+    std::uint32_t nextBelow(std::uint32_t bound)
+    {
+        return static_cast<std::uint32_t>((std::uint64_t{next()} * bound) >> 32);
+    }
+
+private:
+    std::uint64_t m_state{0x853C49E6748FEA9BULL};
+    std::uint64_t m_increment{0xDA3E39CB94B95BDBULL};
+};
+
+// Samples in one period of the noise table; a power of two so positions wrap with a mask
+constexpr std::size_t NOISE_TABLE_SIZE{1024};
+// Table samples between two gradient lattice points
+constexpr std::size_t NOISE_CELL_SIZE{16};
+// Procedural levels are 16-bit fixed point: 65535 = full range
+constexpr std::uint32_t PROCEDURAL_FULL{65535};
+
+/**
+ * One period of smooth 1D gradient noise, 0–PROCEDURAL_FULL. Built once on
+ * first use from a fixed seed, so every run sees the same table.
+ */
+const std::array<std::uint16_t, NOISE_TABLE_SIZE> &noiseTable();
+
+/**
+ * Per-channel state of a procedural pattern.
+ */
+struct ProceduralState
+{
+    Pcg32 rng;
+    std::uint32_t phase{0};   // Position in the noise table, 24.8 fixed point
+    std::uint32_t sparkle{0}; // Twinkle: level of the current sparkle
+};
+
+// Seeds a channel's generator; each channel gets its own stream and a random start in the table
+ProceduralState makeProceduralState(std::uint32_t seed, std::size_t channel);
+
+// Candle: a steady glow wandering with slow noise, with an occasional short dip
+std::uint32_t flickerLevel(ProceduralState &state, int speed);
+
+// Fire: two noise octaves, squared for contrast, never fully dark
+std::uint32_t fireLevel(ProceduralState &state, int speed);
+
+// Twinkle: a dim glow with random sparkles that decay away
+std::uint32_t twinkleLevel(ProceduralState &state, int speed);
@@ -0,0 +1,1479 @@
+#include "pwm_engine.h"
+
+#include <algorithm> // std::clamp, std::min, std::max, std::find_if, std::any_of
+#include <cmath>     // std::exp, std::lround for the smoothing factor
+#include <limits>    // Unlimited slew rate
+#include <utility>   // std::move
+#include <pigpio.h>  // Raspberry Pi GPIO control (PWM)
+#include <QtGlobal>  // qWarning
+#include "effect_scripts.h"
+
+// Same as pigpio's default software PWM frequency
+constexpr unsigned DEFAULT_HARDWARE_PWM_HZ{800};
+
+// Below this many channels a frame is evaluated inline; waking the pool would cost more
+constexpr std::size_t PARALLEL_MIN_CHANNELS{512};
+// Largest zone task; bigger zones are split so the pool can balance them
+constexpr std::size_t MAX_TASK_CHANNELS{256};
+// Channels blended per compositor task
+constexpr std::size_t COMPOSE_TASK_CHANNELS{1024};
+// Pattern value meaning "this channel's pattern is evaluated elsewhere"
+constexpr int NO_PATTERN_VALUE{-1};
+
+// Sliders and scenes share a priority, so by default the last one moved wins
+constexpr int GUI_SOURCE_PRIORITY{100};
+constexpr int SCENE_SOURCE_PRIORITY{100};
+// Equal too, so a slider moved after a frame arrived takes the channel until the ring changes it again
+constexpr int RING_SOURCE_PRIORITY{100};
+
+PwmEngine::PwmEngine()
+    : m_guiSource{m_merger.addSource("GUI", GUI_SOURCE_PRIORITY)},
+      m_sceneSource{m_merger.addSource("Scenes", SCENE_SOURCE_PRIORITY)},
+      m_ringSource{m_merger.addSource("Frame ring", RING_SOURCE_PRIORITY)}
+{
+}
+
+/**
+ * Finds the channel that a new channel replaces: the one on the same pin,
+ * or for simulated channels the one with the same name.
+ */
+static const Channel *findPrevious(const std::vector<Channel> &channels, const ChannelConfig &config)
+{
+    const auto it{std::find_if(channels.begin(), channels.end(), [&config](const Channel &channel)
+                               { return config.gpioPin != NO_GPIO ? channel.gpioPin == config.gpioPin
+                                                                  : channel.gpioPin == NO_GPIO && channel.name == config.name; })};
+    return it != channels.end() ? &*it : nullptr;
+}
+
+/**
+ * Finds the saved state of a channel, matched the same way as findPrevious().
+ */
+static const SavedChannel *findSaved(const std::vector<SavedChannel> &channels, const ChannelConfig &config)
+{
+    const std::uint32_t nameHash{stateNameHash(config.name)};
+    const auto it{std::find_if(channels.begin(), channels.end(), [&config, nameHash](const SavedChannel &channel)
+                               { return config.gpioPin != NO_GPIO ? channel.gpioPin == config.gpioPin
+                                                                  : channel.gpioPin == NO_GPIO && channel.nameHash == nameHash; })};
+    return it != channels.end() && it->range > 0 ? &*it : nullptr;
+}
+
+/**
+ * Warns when an output device did not take a frame (a spidev transfer
+ * longer than its bufsiz, a broken pipe, ...). A device that keeps
+ * failing is reported once, until it has worked again. Returns whether
+ * it is failing now.
+ */
+static bool reportOutput(bool ok, bool failing, const char *kind, const std::string &name)
+{
+    if (!ok && !failing)
+    {
+        qWarning("%s \"%s\": the device did not take a frame", kind, name.c_str());
+    }
+    return !ok;
+}
+
+// Patterns that need nothing from the config but the channel itself, so a scene may switch between them
+static bool isBuiltinPattern(Pattern pattern)
+{
+    return pattern == Pattern::Manual || pattern == Pattern::Fade || pattern == Pattern::Flicker ||
+           pattern == Pattern::Fire || pattern == Pattern::Twinkle;
+}
+
+/**
+ * Rebuilds the channel list from config. Channels that keep their pin keep
+ * their duty, output and fade position (rescaled to a new range), and group
+ * faders keep their level, so a reload does not make the outputs jump.
+ * Pins that are no longer used are turned off. Channels that are not
+ * carried over start from the state given to restoreState(), if any, so
+ * their first write is already the restored output.
+ */
+void PwmEngine::applyConfig(RigConfigPtr config)
+{
+    m_layoutListeners.notify(false);
+
+    std::vector<Channel> channels;
+    std::vector<int> effects; // Pattern values carried over, so fades don't blink
+    channels.reserve(config->channels.size());
+    effects.reserve(config->channels.size());
+    for (const ChannelConfig &settings : config->channels)
+    {
+        Channel channel{settings.name, settings.gpioPin, settings.pattern == Pattern::Manual,
+                        settings.color, settings.range, settings.frequency, settings.hardwarePwm};
+        channel.pattern = settings.pattern;
+        channel.step = settings.step;
+        channel.inverted = settings.inverted;
+        channel.procedural = makeProceduralState(config->seed, channels.size());
+
+        const Channel *previous{findPrevious(m_channels, settings)};
+        if (previous != nullptr)
+        {
+            channel.duty = previous->duty * channel.range / previous->range;
+            channel.output = previous->output * channel.range / previous->range;
+            channel.brightness = previous->brightness * channel.range / previous->range;
+            channel.increasing = previous->increasing;
+        }
+        const SavedChannel *saved{previous == nullptr ? findSaved(m_restore.channels, settings) : nullptr};
+        if (saved != nullptr)
+        {
+            // Scene recalls may have switched the pattern since the config was loaded
+            if (isBuiltinPattern(saved->pattern) && isBuiltinPattern(channel.pattern))
+            {
+                channel.pattern = saved->pattern;
+                channel.manual = saved->pattern == Pattern::Manual;
+                channel.step = saved->step;
+                channel.inverted = saved->inverted;
+            }
+            channel.duty = saved->duty * channel.range / saved->range;
+            channel.output = saved->output * channel.range / saved->range;
+            channel.brightness = saved->brightness * channel.range / saved->range;
+            channel.increasing = saved->increasing;
+        }
+        if (previous != nullptr && channel.pattern != Pattern::Manual)
+        {
+            effects.push_back(m_compositor.value(Layer::Effects, static_cast<std::size_t>(previous - m_channels.data())) *
+                              channel.range / previous->range);
+        }
+        else if (saved != nullptr && channel.pattern != Pattern::Manual && saved->effect >= 0)
+        {
+            effects.push_back(saved->effect * channel.range / saved->range);
+        }
+        else
+        {
+            effects.push_back(-1);
+        }
+
+        // Only pins that are new or whose PWM setup changed are touched
+        if (m_hardwareOutput && channel.gpioPin != NO_GPIO &&
+            (previous == nullptr || previous->range != channel.range ||
+             previous->frequency != channel.frequency || previous->hardwarePwm != channel.hardwarePwm))
+        {
+            setupPin(channel);
+            writePin(channel, channel.output);
+        }
+        channels.push_back(std::move(channel));
+    }
+
+    // Turn off pins that the new config no longer drives
+    for (const Channel &old : m_channels)
+    {
+        const bool kept{std::any_of(channels.begin(), channels.end(), [&old](const Channel &channel)
+                                    { return channel.gpioPin == old.gpioPin; })};
+        if (m_hardwareOutput && old.gpioPin != NO_GPIO && !kept)
+        {
+            writePin(old, 0);
+        }
+    }
+
+    // And strips it no longer has
+    for (const StripConfig &old : m_config->strips)
+    {
+        const bool kept{std::any_of(config->strips.begin(), config->strips.end(), [&old](const StripConfig &strip)
+                                    { return strip.output->device() == old.output->device(); })};
+        if (!kept)
+        {
+            old.output->clear();
+            reportOutput(old.output->show(), false, "Strip", old.name);
+        }
+    }
+    for (const ExpanderConfig &old : m_config->expanders)
+    {
+        const bool kept{std::any_of(config->expanders.begin(), config->expanders.end(),
+                                    [&old](const ExpanderConfig &expander)
+                                    { return expander.output->device() == old.output->device() &&
+                                             expander.output->address() == old.output->address(); })};
+        if (!kept)
+        {
+            old.output->allOff();
+        }
+    }
+    for (const ControllerConfig &old : m_config->controllers)
+    {
+        const bool kept{std::any_of(config->controllers.begin(), config->controllers.end(),
+                                    [&old](const ControllerConfig &controller)
+                                    { return controller.output->device() == old.output->device(); })};
+        if (!kept)
+        {
+            old.output->allOff();
+        }
+    }
+
+    m_channels = std::move(channels);
+    m_config = std::move(config);
+    if (!m_restore.channels.empty())
+    {
+        m_time = m_restore.time; // Expressions and plugins continue instead of starting over
+    }
+    buildGroups();
+    buildAmbient();
+    buildStrips();
+    buildExpanders();
+    buildControllers();
+    buildSlew();
+    buildZoneTasks();
+
+    // Channel indices may have changed, so a running crossfade is dropped
+    m_crossfade.clear();
+    m_crossfade.reserve(m_channels.size());
+    m_crossfadeLive.assign(m_channels.size(), NO_PATTERN_VALUE);
+    m_crossfadeFrames = 0;
+
+    m_dirty.clear();
+    m_dirty.reserve(m_channels.size());
+    resetCompositor(effects);
+
+    buildExpressionGroups();
+    buildPluginGroups();
+    m_scripts.reset(m_channels.size(), m_config->frameIntervalMs);
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        if (m_channels[i].pattern == Pattern::Script)
+        {
+            startScript(i);
+        }
+    }
+
+    m_layoutListeners.notify(true);
+
+    // Zones may have changed, so every output is checked once
+    mergeSources();
+    compose();
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        markDirty(i);
+    }
+    flushOutputs();
+    paintStrips(); // The output devices may be new, so they get a full frame
+    paintExpanders();
+    paintControllers();
+    m_restore = EngineState{}; // Only the first config after restoreState() starts from it
+}
+
+/**
+ * Loads blend modes, merge policies and base levels from the config and
+ * puts the current manual and pattern values back onto their layers. The
+ * carried-over duty is restored on the GUI source. effects holds -1 for
+ * channels that have no pattern value yet.
+ */
+void PwmEngine::resetCompositor(const std::vector<int> &effects)
+{
+    std::vector<int> ranges(m_channels.size());
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        ranges[i] = m_channels[i].range;
+    }
+    m_compositor.reset(ranges);
+    m_merger.reset(m_channels.size());
+    m_levels.reserve(m_channels.size());
+    m_ringValues.assign(m_channels.size(), -1);
+    if (m_frameRing)
+    {
+        m_frameRing->replay(); // The merger forgot the ring's values
+    }
+
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const ChannelConfig &settings{m_config->channels[i]};
+        for (std::size_t layer{0}; layer < Compositor::LAYER_COUNT; ++layer)
+        {
+            m_compositor.setBlend(static_cast<Layer>(layer), i, settings.blend[layer]);
+        }
+        if (settings.base > 0)
+        {
+            m_compositor.setValue(Layer::Base, i, settings.base);
+        }
+        m_merger.setPolicy(i, settings.merge);
+        if (m_channels[i].manual || m_channels[i].duty > 0)
+        {
+            m_merger.setValue(m_guiSource, i, m_channels[i].duty);
+            m_compositor.setValue(Layer::Manual, i, m_channels[i].duty);
+        }
+        if (effects[i] >= 0)
+        {
+            m_compositor.setValue(Layer::Effects, i, effects[i]);
+        }
+    }
+}
+
+/**
+ * Applies the newest complete frame of the ring.
+ * Only channels whose value differs from the ring's previous frame are
+ * written, so an unchanged channel keeps whatever a slider set since.
+ */
+void PwmEngine::consumeFrameRing()
+{
+    if (!m_frameRing)
+    {
+        return;
+    }
+    m_frameRing->consume([this](const std::uint16_t *levels, std::size_t count)
+                         {
+                             const std::size_t channels{std::min(count, m_channels.size())};
+                             for (std::size_t i{0}; i < channels; ++i)
+                             {
+                                 const int range{m_channels[i].range};
+                                 const int value{static_cast<int>((static_cast<long long>(levels[i]) * range + 0x7FFF) / 0xFFFF)};
+                                 if (value != m_ringValues[i])
+                                 {
+                                     m_ringValues[i] = value;
+                                     m_merger.setValue(m_ringSource, i, value);
+                                 }
+                             } });
+}
+
+void PwmEngine::setFrameRing(std::unique_ptr<FrameRing> ring)
+{
+    m_frameRing = std::move(ring);
+    for (std::size_t i{0}; i < m_ringValues.size(); ++i)
+    {
+        if (m_ringValues[i] >= 0)
+        {
+            m_merger.release(m_ringSource, i);
+            m_ringValues[i] = -1;
+        }
+    }
+}
+
+/**
+ * Merges the sources that changed since the last frame and puts the result
+ * on the manual layer.
+ */
+void PwmEngine::mergeSources()
+{
+    m_merger.merge([this](std::size_t index, int duty)
+                   {
+                       m_channels[index].duty = duty;
+                       m_compositor.setValue(Layer::Manual, index, duty);
+                       m_dutyListeners.notify(index); });
+}
+
+/**
+ * Blends the layers if any of them changed this frame and marks the
+ * channels whose level moved.
+ */
+void PwmEngine::compose()
+{
+    if (!m_compositor.changed())
+    {
+        return;
+    }
+
+    if (parallel())
+    {
+        m_compositor.prepare(m_levels);
+        auto blendTask{[this](std::size_t task)
+                       {
+                           const std::size_t begin{task * COMPOSE_TASK_CHANNELS};
+                           const std::size_t end{std::min(begin + COMPOSE_TASK_CHANNELS, m_levels.size())};
+                           m_compositor.evaluateRange(m_levels.data(), begin, end);
+                       }};
+        m_pool->run((m_levels.size() + COMPOSE_TASK_CHANNELS - 1) / COMPOSE_TASK_CHANNELS, blendTask);
+        m_compositor.markEvaluated();
+    }
+    else
+    {
+        m_compositor.evaluate(m_levels);
+    }
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const auto level{static_cast<int>(m_levels[i])};
+        if (m_channels[i].level != level)
+        {
+            m_channels[i].level = level;
+            markDirty(i);
+        }
+    }
+}
+
+void PwmEngine::setBlackout(bool enabled)
+{
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        if (enabled)
+        {
+            m_compositor.setValue(Layer::Override, i, 0);
+        }
+        else
+        {
+            m_compositor.clearValue(Layer::Override, i);
+        }
+    }
+}
+
+/**
+ * Builds the fader tree for the current config: the master, then one zone
+ * submaster per distinct "zone" name. Levels are carried over by name.
+ */
+void PwmEngine::buildGroups()
+{
+    std::vector<Group> groups;
+    groups.push_back(Group{"Master", 255, NO_GROUP, {}});
+
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const std::string &zone{m_config->channels[i].zone};
+        std::size_t index{0};
+        if (!zone.empty())
+        {
+            index = 1;
+            while (index < groups.size() && groups[index].name != zone)
+            {
+                ++index;
+            }
+            if (index == groups.size())
+            {
+                groups.push_back(Group{zone, 255, 0, {}});
+            }
+            groups[index].channels.push_back(i);
+        }
+        groups[0].channels.push_back(i);
+        m_channels[i].group = index;
+    }
+
+    for (Group &group : groups)
+    {
+        const auto old{std::find_if(m_groups.begin(), m_groups.end(), [&group](const Group &old)
+                                    { return old.name == group.name; })};
+        if (old != m_groups.end())
+        {
+            group.level = old->level;
+            continue;
+        }
+        const std::uint32_t nameHash{stateNameHash(group.name)};
+        const auto saved{std::find_if(m_restore.groups.begin(), m_restore.groups.end(), [nameHash](const SavedGroup &saved)
+                                      { return saved.nameHash == nameHash; })};
+        if (saved != m_restore.groups.end())
+        {
+            group.level = std::clamp(saved->level, 0, 255);
+        }
+    }
+    m_groups = std::move(groups);
+}
+
+/**
+ * Places every strip channel on its strip, in config order.
+ */
+void PwmEngine::buildStrips()
+{
+    std::vector<std::size_t> leds(m_config->strips.size(), 0);
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const std::string &name{m_config->channels[i].strip};
+        for (std::size_t strip{0}; strip < m_config->strips.size() && !name.empty(); ++strip)
+        {
+            if (m_config->strips[strip].name == name)
+            {
+                m_channels[i].strip = strip;
+                m_channels[i].pixel = leds[strip]++;
+            }
+        }
+    }
+    m_stripChanged.assign(m_config->strips.size(), false);
+    m_stripFailing.assign(m_config->strips.size(), false);
+}
+
+// Sets every LED from its channel's output and sends all strips
+void PwmEngine::paintStrips()
+{
+    for (const Channel &channel : m_channels)
+    {
+        if (channel.strip != NO_STRIP)
+        {
+            m_config->strips[channel.strip].output->setPixel(channel.pixel, channel.color, channel.output, channel.range);
+        }
+    }
+    m_stripChanged.assign(m_stripChanged.size(), true);
+    showStrips();
+}
+
+// Sends the strips that changed; each one goes out as a single transfer
+void PwmEngine::showStrips()
+{
+    for (std::size_t strip{0}; strip < m_stripChanged.size(); ++strip)
+    {
+        if (m_stripChanged[strip])
+        {
+            const StripConfig &config{m_config->strips[strip]};
+            m_stripFailing[strip] = reportOutput(config.output->show(), m_stripFailing[strip], "Strip", config.name);
+            m_stripChanged[strip] = false;
+        }
+    }
+}
+
+void PwmEngine::buildExpanders()
+{
+    m_expanderFailing.assign(m_config->expanders.size(), false);
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const ChannelConfig &settings{m_config->channels[i]};
+        for (std::size_t expander{0}; expander < m_config->expanders.size() && !settings.expander.empty(); ++expander)
+        {
+            if (m_config->expanders[expander].name == settings.expander)
+            {
+                m_channels[i].expander = expander;
+                m_channels[i].expanderOutput = static_cast<std::size_t>(settings.expanderOutput);
+            }
+        }
+    }
+}
+
+// Sets every expander output from its channel and sends them
+void PwmEngine::paintExpanders()
+{
+    for (const Channel &channel : m_channels)
+    {
+        if (channel.expander != NO_EXPANDER)
+        {
+            m_config->expanders[channel.expander].output->setOutput(channel.expanderOutput, channel.output, channel.range);
+        }
+    }
+    flushExpanders();
+}
+
+// Sends each expander's changed outputs in one transfer, which latches them together
+void PwmEngine::flushExpanders()
+{
+    for (std::size_t expander{0}; expander < m_config->expanders.size(); ++expander)
+    {
+        const ExpanderConfig &config{m_config->expanders[expander]};
+        m_expanderFailing[expander] = reportOutput(config.output->flush(), m_expanderFailing[expander], "Expander",
+                                                   config.name);
+    }
+}
+
+/**
+ * Numbers every offloaded channel within its controller's frame, in config order.
+ */
+void PwmEngine::buildControllers()
+{
+    m_controllerFailing.assign(m_config->controllers.size(), false);
+    std::vector<std::size_t> counts(m_config->controllers.size(), 0);
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const std::string &name{m_config->channels[i].controller};
+        for (std::size_t controller{0}; controller < m_config->controllers.size() && !name.empty(); ++controller)
+        {
+            if (m_config->controllers[controller].name == name)
+            {
+                m_channels[i].controller = controller;
+                m_channels[i].controllerOutput = counts[controller]++;
+            }
+        }
+    }
+}
+
+// Sets every offloaded channel and sends the frames
+void PwmEngine::paintControllers()
+{
+    for (const Channel &channel : m_channels)
+    {
+        if (channel.controller != NO_CONTROLLER)
+        {
+            m_config->controllers[channel.controller].output->setOutput(channel.controllerOutput, channel.output,
+                                                                        channel.range);
+        }
+    }
+    flushControllers();
+}
+
+// Sends one delta frame per controller with the channels that changed
+void PwmEngine::flushControllers()
+{
+    for (std::size_t controller{0}; controller < m_config->controllers.size(); ++controller)
+    {
+        const ControllerConfig &config{m_config->controllers[controller]};
+        m_controllerFailing[controller] = reportOutput(config.output->flush(), m_controllerFailing[controller],
+                                                       "Controller", config.name);
+    }
+}
+
+/**
+ * Configures a pin for PWM output with the channel's frequency and range.
+ * Hardware PWM pins are set up by gpioHardwarePWM itself on every write.
+ */
+void PwmEngine::setupPin(const Channel &channel)
+{
+    gpioSetMode(channel.gpioPin, PI_OUTPUT);
+    if (channel.hardwarePwm)
+    {
+        return;
+    }
+    gpioSetPWMrange(channel.gpioPin, channel.range);
+    if (channel.frequency > 0)
+    {
+        gpioSetPWMfrequency(channel.gpioPin, channel.frequency);
+    }
+}
+
+/**
+ * Writes a duty (0–range) to the channel's pin. The PWM peripheral takes its
+ * duty in millionths, so hardware channels are scaled accordingly.
+ */
+void PwmEngine::writePin(const Channel &channel, int duty) const
+{
+    if (channel.hardwarePwm)
+    {
+        const unsigned frequency{channel.frequency > 0 ? static_cast<unsigned>(channel.frequency)
+                                                       : DEFAULT_HARDWARE_PWM_HZ};
+        gpioHardwarePWM(channel.gpioPin, frequency,
+                        static_cast<unsigned>(static_cast<long long>(duty) * 1000000 / channel.range));
+    }
+    else
+    {
+        gpioPWM(channel.gpioPin, duty);
+    }
+}
+
+void PwmEngine::tick()
+{
+    if (m_pendingConfig)
+    {
+        applyConfig(std::move(m_pendingConfig));
+    }
+
+    consumeFrameRing();
+
+    evaluatePatterns();
+    advanceExpressions();
+    advancePlugins();
+    m_scripts.advance([this](std::size_t index, int level)
+                      {
+                          const Channel &channel{m_channels[index]};
+                          setEffectValue(index, channel.inverted ? channel.range - level : level); });
+    advanceCrossfade(); // After the patterns, so it blends in this frame's values
+    m_time += m_config->frameIntervalMs / 1000.0;
+
+    mergeSources();
+    compose();
+    advanceAmbient();
+    flushOutputs();
+}
+
+void PwmEngine::captureState(EngineState &state) const
+{
+    // resize() keeps the capacity, so saving periodically doesn't allocate
+    state.channels.resize(m_channels.size());
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const Channel &channel{m_channels[i]};
+        state.channels[i] = SavedChannel{channel.gpioPin, stateNameHash(channel.name), channel.range, channel.duty,
+                                         channel.output,
+                                         channel.pattern != Pattern::Manual ? m_compositor.value(Layer::Effects, i) : -1,
+                                         channel.pattern, channel.step, channel.inverted, channel.brightness,
+                                         channel.increasing};
+    }
+    state.groups.resize(m_groups.size());
+    for (std::size_t i{0}; i < m_groups.size(); ++i)
+    {
+        state.groups[i] = SavedGroup{stateNameHash(m_groups[i].name), m_groups[i].level};
+    }
+    state.time = m_time;
+    state.ambientGain = m_ambient ? m_ambient->gain() : 1.0;
+}
+
+void PwmEngine::captureScene(Scene &scene) const
+{
+    // resize() keeps the capacity of a previously used slot
+    scene.channels.resize(m_channels.size());
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const Channel &channel{m_channels[i]};
+        scene.channels[i] = SceneChannel{channel.duty, channel.pattern, channel.step,
+                                         channel.inverted, channel.brightness, channel.increasing};
+    }
+}
+
+void PwmEngine::recallScene(const Scene &scene, int fadeMs)
+{
+    // Restart from wherever a previous crossfade got to
+    for (const CrossfadeStep &step : m_crossfade)
+    {
+        m_channels[step.channel].crossfading = false;
+    }
+    m_crossfade.clear();
+
+    const std::size_t count{std::min(scene.channels.size(), m_channels.size())};
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        const Channel &channel{m_channels[i]};
+        const SceneChannel &target{scene.channels[i]};
+        // The fade position counts too, or recalling a scene could not restore it. A manual
+        // channel may still hold an effect that an interrupted crossfade was fading out.
+        const bool effect{m_compositor.hasValue(Layer::Effects, i)};
+        const bool same{channel.duty == target.duty && channel.pattern == target.pattern &&
+                        channel.step == target.step && channel.inverted == target.inverted &&
+                        channel.brightness == target.brightness && channel.increasing == target.increasing &&
+                        !(target.pattern == Pattern::Manual && effect)};
+        if (same)
+        {
+            continue;
+        }
+        // The old pattern's value is where the blend to the new one starts
+        const int effectFrom{effect                               ? m_compositor.value(Layer::Effects, i)
+                             : target.pattern != Pattern::Manual ? 0
+                                                                  : -1};
+        m_crossfade.push_back(CrossfadeStep{i, channel.duty, effectFrom, target});
+        m_crossfadeLive[i] = NO_PATTERN_VALUE;
+        applyScenePattern(i, target);
+    }
+
+    m_crossfadeFrame = 0;
+    m_crossfadeFrames = std::max(1, fadeMs / m_config->frameIntervalMs);
+    if (fadeMs <= 0)
+    {
+        advanceCrossfade(); // Instant switch: jump straight to the scene
+        return;
+    }
+
+    for (const CrossfadeStep &step : m_crossfade)
+    {
+        m_channels[step.channel].crossfading = true;
+    }
+}
+
+/**
+ * Moves every crossfading channel one frame closer to its scene duty, and
+ * its effects layer from the old pattern's value towards the new one's.
+ * The new pattern already runs (a fade waits at its recalled position), so
+ * at the end it simply takes over. Channels that already matched the
+ * scene are not in the list at all.
+ */
+void PwmEngine::advanceCrossfade()
+{
+    if (m_crossfadeFrames == 0)
+    {
+        return;
+    }
+
+    ++m_crossfadeFrame;
+    if (m_crossfadeFrame >= m_crossfadeFrames)
+    {
+        for (const CrossfadeStep &step : m_crossfade)
+        {
+            finishCrossfadeStep(step);
+        }
+        m_crossfade.clear();
+        m_crossfadeFrames = 0;
+        return;
+    }
+
+    for (const CrossfadeStep &step : m_crossfade)
+    {
+        setSourceValue(m_sceneSource, step.channel,
+                       step.from + (step.to.duty - step.from) * m_crossfadeFrame / m_crossfadeFrames);
+        if (step.effectFrom >= 0)
+        {
+            const int live{m_crossfadeLive[step.channel]};
+            const int to{live != NO_PATTERN_VALUE ? live : 0}; // A manual target fades the effect out
+            m_compositor.setValue(Layer::Effects, step.channel,
+                                  step.effectFrom + (to - step.effectFrom) * m_crossfadeFrame / m_crossfadeFrames);
+        }
+    }
+}
+
+/**
+ * Lands a channel on its scene duty and hands the effects layer to its
+ * pattern; a manual channel has none left.
+ */
+void PwmEngine::finishCrossfadeStep(const CrossfadeStep &step)
+{
+    m_channels[step.channel].crossfading = false;
+    setSourceValue(m_sceneSource, step.channel, step.to.duty);
+    if (step.to.pattern == Pattern::Manual)
+    {
+        if (step.effectFrom >= 0)
+        {
+            m_compositor.clearValue(Layer::Effects, step.channel);
+        }
+    }
+    else if (m_crossfadeLive[step.channel] != NO_PATTERN_VALUE)
+    {
+        m_compositor.setValue(Layer::Effects, step.channel, m_crossfadeLive[step.channel]);
+    }
+}
+
+/**
+ * Switches a channel to a scene's pattern settings and fade position,
+ * starting or cancelling its script.
+ */
+void PwmEngine::applyScenePattern(std::size_t index, const SceneChannel &target)
+{
+    Channel &channel{m_channels[index]};
+    if (target.pattern != channel.pattern)
+    {
+        if (target.pattern == Pattern::Script)
+        {
+            channel.pattern = target.pattern;
+            startScript(index);
+        }
+        else
+        {
+            m_scripts.cancel(index);
+        }
+    }
+    channel.pattern = target.pattern;
+    channel.manual = target.pattern == Pattern::Manual;
+    channel.step = target.step;
+    m_scripts.setStep(index, channel.step);
+    channel.inverted = target.inverted;
+    channel.brightness = std::clamp(target.brightness, 0, channel.range);
+    channel.increasing = target.increasing;
+}
+
+/**
+ * Puts a pattern's value on the effects layer, or keeps it for the blend
+ * while the channel is crossfading.
+ */
+void PwmEngine::setEffectValue(std::size_t index, int value)
+{
+    if (m_channels[index].crossfading)
+    {
+        m_crossfadeLive[index] = value;
+        return;
+    }
+    m_compositor.setValue(Layer::Effects, index, value);
+}
+
+void PwmEngine::setWorkerThreads(std::size_t threads)
+{
+    m_pool = threads > 1 ? std::make_unique<WorkPool>(threads) : nullptr;
+}
+
+/**
+ * Orders the channels zone by zone (unzoned channels last) and cuts the
+ * list into tasks of at most MAX_TASK_CHANNELS.
+ */
+void PwmEngine::buildZoneTasks()
+{
+    m_taskChannels.clear();
+    m_zoneTasks.clear();
+    const auto addTasks{[this](std::size_t begin)
+                        {
+                            for (std::size_t first{begin}; first < m_taskChannels.size(); first += MAX_TASK_CHANNELS)
+                            {
+                                m_zoneTasks.push_back(ZoneTask{first, std::min(first + MAX_TASK_CHANNELS, m_taskChannels.size())});
+                            }
+                        }};
+
+    for (std::size_t group{1}; group < m_groups.size(); ++group)
+    {
+        const std::size_t begin{m_taskChannels.size()};
+        m_taskChannels.insert(m_taskChannels.end(), m_groups[group].channels.begin(), m_groups[group].channels.end());
+        addTasks(begin);
+    }
+
+    const std::size_t begin{m_taskChannels.size()};
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        if (m_channels[i].group == 0)
+        {
+            m_taskChannels.push_back(i);
+        }
+    }
+    addTasks(begin);
+
+    m_effectStaging.assign(m_channels.size(), NO_PATTERN_VALUE);
+}
+
+bool PwmEngine::parallel() const
+{
+    return m_pool && m_channels.size() >= PARALLEL_MIN_CHANNELS;
+}
+
+/**
+ * Runs the per-channel patterns. Small rigs are done inline. Large ones
+ * run one task per zone on the pool; a task only touches its own channels
+ * and their staging slots. The results go onto the effects layer after
+ * the join, on this thread.
+ */
+void PwmEngine::evaluatePatterns()
+{
+    if (!parallel())
+    {
+        for (std::size_t i{0}; i < m_channels.size(); ++i)
+        {
+            const int value{advancePattern(i)};
+            if (value != NO_PATTERN_VALUE)
+            {
+                setEffectValue(i, value);
+            }
+        }
+        return;
+    }
+
+    auto zoneTask{[this](std::size_t task)
+                  {
+                      for (std::size_t k{m_zoneTasks[task].begin}; k < m_zoneTasks[task].end; ++k)
+                      {
+                          const std::size_t index{m_taskChannels[k]};
+                          m_effectStaging[index] = advancePattern(index);
+                      }
+                  }};
+    m_pool->run(m_zoneTasks.size(), zoneTask);
+
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        if (m_effectStaging[i] != NO_PATTERN_VALUE)
+        {
+            setEffectValue(i, m_effectStaging[i]);
+        }
+    }
+}
+
+/**
+ * Runs one frame of a channel's own pattern and returns its effects layer
+ * value, or NO_PATTERN_VALUE for patterns that are evaluated elsewhere.
+ * Only the channel itself is touched, so channels can run on any thread.
+ * Procedural patterns are fixed point throughout: table lookups and
+ * integer maths, no libm calls per frame.
+ */
+int PwmEngine::advancePattern(std::size_t index)
+{
+    Channel &channel{m_channels[index]};
+    if (channel.crossfading && channel.pattern == Pattern::Fade)
+    {
+        // Held at the recalled position, which the crossfade ends on
+        return channel.inverted ? channel.range - channel.brightness : channel.brightness;
+    }
+
+    std::uint32_t level{0};
+    switch (channel.pattern)
+    {
+    case Pattern::Fade:
+        return advanceFade(index);
+    case Pattern::Flicker:
+        level = flickerLevel(channel.procedural, channel.step);
+        break;
+    case Pattern::Fire:
+        level = fireLevel(channel.procedural, channel.step);
+        break;
+    case Pattern::Twinkle:
+        level = twinkleLevel(channel.procedural, channel.step);
+        break;
+    case Pattern::Manual:
+    case Pattern::Script:     // Resumed by the script scheduler
+    case Pattern::Expression: // Evaluated in batches by advanceExpressions()
+    case Pattern::Plugin:     // Evaluated in batches by advancePlugins()
+        return NO_PATTERN_VALUE;
+    }
+
+    const auto value{static_cast<int>(level * static_cast<std::uint32_t>(channel.range) / PROCEDURAL_FULL)};
+    return channel.inverted ? channel.range - value : value;
+}
+
+/**
+ * Starts the channel's configured script, seeded like the procedural patterns.
+ */
+void PwmEngine::startScript(std::size_t index)
+{
+    const EffectScript script{findEffectScript(m_config->channels[index].script)};
+    if (script != nullptr)
+    {
+        m_scripts.start(index, script, m_channels[index].range, m_channels[index].step, m_config->seed);
+    }
+}
+
+/**
+ * Groups the channels that have an expression by compiled program. Scenes
+ * may switch a channel to or from the expression pattern, so every channel
+ * with a formula is grouped and the pattern is checked per frame.
+ */
+void PwmEngine::buildExpressionGroups()
+{
+    m_expressionGroups.clear();
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const Expression *expression{m_config->channels[i].expression.get()};
+        if (expression == nullptr)
+        {
+            continue;
+        }
+
+        auto group{std::find_if(m_expressionGroups.begin(), m_expressionGroups.end(),
+                                [expression](const ExpressionGroup &candidate)
+                                { return candidate.expression == expression; })};
+        if (group == m_expressionGroups.end())
+        {
+            m_expressionGroups.push_back(ExpressionGroup{expression, {}, {}, {}});
+            group = m_expressionGroups.end() - 1;
+        }
+        group->channels.push_back(i);
+        group->index.push_back(static_cast<float>(i));
+        group->range.push_back(static_cast<float>(m_channels[i].range));
+    }
+}
+
+/**
+ * Evaluates every expression group, one batch of channels per interpreter
+ * pass, and puts the results (clamped to the range) on the effects layer.
+ */
+void PwmEngine::advanceExpressions()
+{
+    float results[Expression::BATCH];
+    for (const ExpressionGroup &group : m_expressionGroups)
+    {
+        for (std::size_t first{0}; first < group.channels.size(); first += Expression::BATCH)
+        {
+            const std::size_t count{std::min(Expression::BATCH, group.channels.size() - first)};
+            group.expression->evaluate(m_time, &group.index[first], &group.range[first], count, results);
+
+            for (std::size_t k{0}; k < count; ++k)
+            {
+                const std::size_t index{group.channels[first + k]};
+                const Channel &channel{m_channels[index]};
+                if (channel.pattern != Pattern::Expression)
+                {
+                    continue;
+                }
+                // NaN (e.g. 0/0) counts as 0
+                const float clamped{results[k] > 0.0f ? std::min(results[k], group.range[first + k]) : 0.0f};
+                const auto value{static_cast<int>(clamped + 0.5f)};
+                setEffectValue(index, channel.inverted ? channel.range - value : value);
+            }
+        }
+    }
+}
+
+/**
+ * Creates one plugin state per plugin, covering every channel that names
+ * it. The states of the previous config, and with them any replaced
+ * plugin, are released here, between two frames.
+ */
+void PwmEngine::buildPluginGroups()
+{
+    m_pluginGroups.clear();
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const std::shared_ptr<const EffectPlugin> &plugin{m_config->channels[i].plugin};
+        if (!plugin)
+        {
+            continue;
+        }
+
+        auto group{std::find_if(m_pluginGroups.begin(), m_pluginGroups.end(),
+                                [&plugin](const PluginGroup &candidate)
+                                { return candidate.plugin == plugin; })};
+        if (group == m_pluginGroups.end())
+        {
+            m_pluginGroups.push_back(PluginGroup{plugin, {nullptr, plugin->api().destroy}, {}, {}, {}, {}});
+            group = m_pluginGroups.end() - 1;
+        }
+        group->channels.push_back(i);
+        group->index.push_back(static_cast<std::uint32_t>(i));
+        group->range.push_back(m_channels[i].range);
+    }
+
+    for (PluginGroup &group : m_pluginGroups)
+    {
+        group.out.resize(group.channels.size());
+        group.state.reset(group.plugin->api().init(static_cast<std::uint32_t>(group.channels.size()), m_config->seed));
+    }
+}
+
+/**
+ * Calls every plugin once per frame with all of its channels, so the cost
+ * of the call is spread over the whole batch.
+ */
+void PwmEngine::advancePlugins()
+{
+    for (PluginGroup &group : m_pluginGroups)
+    {
+        const PwmEffectBatch batch{static_cast<std::uint32_t>(group.channels.size()), group.index.data(),
+                                   group.range.data(), m_time, group.out.data()};
+        group.plugin->api().evaluate(group.state.get(), &batch);
+
+        for (std::size_t k{0}; k < group.channels.size(); ++k)
+        {
+            const std::size_t index{group.channels[k]};
+            const Channel &channel{m_channels[index]};
+            if (channel.pattern != Pattern::Plugin)
+            {
+                continue;
+            }
+            const int value{std::clamp(static_cast<int>(group.out[k]), 0, channel.range)};
+            setEffectValue(index, channel.inverted ? channel.range - value : value);
+        }
+    }
+}
+
+/**
+ * Runs one frame of the fade: output the current brightness (or its inverse
+ * for the see-saw partner), then move it towards the end it is heading for.
+ */
+int PwmEngine::advanceFade(std::size_t index)
+{
+    Channel &channel{m_channels[index]};
+    const int value{channel.inverted ? channel.range - channel.brightness : channel.brightness};
+
+    if (channel.increasing)
+    {
+        channel.brightness += channel.step;
+        if (channel.brightness >= channel.range)
+        {
+            channel.brightness = channel.range; // Cap max value
+            channel.increasing = false;         // Start fading down
+        }
+    }
+    else
+    {
+        channel.brightness -= channel.step;
+        if (channel.brightness <= 0)
+        {
+            channel.brightness = 0;     // Cap min value
+            channel.increasing = true;  // Start fading up
+        }
+    }
+    return value;
+}
+
+void PwmEngine::setDuty(std::size_t index, int duty)
+{
+    setSourceValue(m_guiSource, index, duty);
+}
+
+/**
+ * Stores a source's value for a channel. The sources are merged and the pin
+ * written on the next frame, together with every other channel that changed.
+ */
+void PwmEngine::setSourceValue(SourceId source, std::size_t index, int value)
+{
+    m_merger.setValue(source, index, std::clamp(value, 0, m_channels[index].range));
+}
+
+/**
+ * Moves a group fader. Only the channels below that group are marked dirty,
+ * so a zone fader leaves the rest of the rig alone.
+ */
+void PwmEngine::setGroupLevel(std::size_t group, int level)
+{
+    Group &target{m_groups[group]};
+    level = std::clamp(level, 0, 255);
+    if (target.level == level)
+    {
+        return;
+    }
+
+    target.level = level;
+    for (std::size_t index : target.channels)
+    {
+        markDirty(index);
+    }
+}
+
+/**
+ * Starts the ambient loop of a new config on its zone. A loop that was
+ * already running passes its gain on, and the first config after
+ * restoreState() starts from the saved one, so the light does not jump.
+ */
+void PwmEngine::buildAmbient()
+{
+    const AmbientConfig &ambient{m_config->ambient};
+    const double gain{m_ambient                     ? m_ambient->gain()
+                      : !m_restore.channels.empty() ? m_restore.ambientGain
+                                                    : 1.0};
+    if (!ambient.sensor)
+    {
+        m_ambient.reset();
+        return;
+    }
+
+    const auto zone{std::find_if(m_groups.begin(), m_groups.end(), [&ambient](const Group &group)
+                                 { return group.name == ambient.zone; })};
+    m_ambientGroup = ambient.zone.empty() || zone == m_groups.end() ? 0 : static_cast<std::size_t>(zone - m_groups.begin());
+    m_ambient = std::make_unique<AmbientController>(ambient, gain);
+    m_ambientFrames = std::max(1, ambient.intervalMs / m_config->frameIntervalMs);
+    m_ambientFrame = 0;
+    m_ambientLastStep = {};
+    setAmbientGain(m_ambient->gain());
+}
+
+/**
+ * One step of the ambient loop every m_ambientFrames frames. The sensor
+ * read only picks up a sample, so the step is bounded by the walk over
+ * the zone's channels.
+ */
+void PwmEngine::advanceAmbient()
+{
+    if (!m_ambient || ++m_ambientFrame < m_ambientFrames)
+    {
+        return;
+    }
+    m_ambientFrame = 0;
+    const auto start{std::chrono::steady_clock::now()};
+
+    // What the zone puts out now, for a simulated room
+    const Group &group{m_groups[m_ambientGroup]};
+    double output{0.0};
+    for (std::size_t index : group.channels)
+    {
+        output += static_cast<double>(m_channels[index].output) / m_channels[index].range;
+    }
+    output /= static_cast<double>(std::max<std::size_t>(1, group.channels.size()));
+
+    double lux{0.0};
+    if (m_config->ambient.sensor->read(m_time, output, lux))
+    {
+        setAmbientGain(m_ambient->update(lux, m_time));
+    }
+    else
+    {
+        m_ambient->hold();
+    }
+
+    const auto end{std::chrono::steady_clock::now()};
+    const std::chrono::duration<double, std::milli> interval{m_ambientFrames * m_config->frameIntervalMs};
+    const double lateMs{m_ambientLastStep != std::chrono::steady_clock::time_point{}
+                            ? (std::chrono::duration<double, std::milli>(start - m_ambientLastStep) - interval).count()
+                            : 0.0};
+    m_ambient->recordTiming(std::chrono::duration<double, std::micro>(end - start).count(), std::max(0.0, lateMs));
+    m_ambientLastStep = start;
+}
+
+void PwmEngine::setAmbientGain(double gain)
+{
+    Group &target{m_groups[m_ambientGroup]};
+    const int ambient{static_cast<int>(gain * AMBIENT_UNITY + 0.5)};
+    if (target.ambient == ambient)
+    {
+        return;
+    }
+
+    target.ambient = ambient;
+    for (std::size_t index : target.channels)
+    {
+        markDirty(index);
+    }
+}
+
+void PwmEngine::markDirty(std::size_t index)
+{
+    Channel &channel{m_channels[index]};
+    if (!channel.dirty)
+    {
+        channel.dirty = true;
+        m_dirty.push_back(index);
+    }
+}
+
+/**
+ * The composited level scaled by every fader between the channel and the master.
+ */
+int PwmEngine::effectiveOutput(const Channel &channel) const
+{
+    int output{channel.level};
+    for (std::size_t group{channel.group}; group != NO_GROUP; group = m_groups[group].parent)
+    {
+        output = static_cast<int>(static_cast<long long>(output) * m_groups[group].level * m_groups[group].ambient /
+                                  (255 * AMBIENT_UNITY));
+    }
+    return output;
+}
+
+/**
+ * Recomputes the dirty channels and writes the ones whose output changed.
+ * Smoothed channels get the result as their target instead, and every
+ * frame advanceSlew() moves them towards it.
+ */
+void PwmEngine::flushOutputs()
+{
+    for (std::size_t index : m_dirty)
+    {
+        Channel &channel{m_channels[index]};
+        channel.dirty = false;
+
+        const int output{effectiveOutput(channel)};
+        if (channel.slew != NO_SLEW)
+        {
+            // Smoothed channels only get a new target; advanceSlew() moves the output
+            m_slewTarget[channel.slew] = output << SLEW_SHIFT;
+            m_slewSettled = false;
+            continue;
+        }
+        if (output != channel.output)
+        {
+            commitOutput(index, output);
+        }
+    }
+    m_dirty.clear();
+    advanceSlew();
+    showStrips();
+    flushExpanders();
+    flushControllers(); // Also every frame without changes, for the periodic keyframe
+}
+
+// Writes a channel's new output to wherever it goes and reports it
+void PwmEngine::commitOutput(std::size_t index, int output)
+{
+    Channel &channel{m_channels[index]};
+    channel.output = output;
+    if (m_hardwareOutput && channel.gpioPin != NO_GPIO && !channel.claimed)
+    {
+        writePin(channel, output);
+    }
+    if (channel.strip != NO_STRIP && !channel.claimed)
+    {
+        m_config->strips[channel.strip].output->setPixel(channel.pixel, channel.color, output, channel.range);
+        m_stripChanged[channel.strip] = true;
+    }
+    if (channel.expander != NO_EXPANDER && !channel.claimed)
+    {
+        m_config->expanders[channel.expander].output->setOutput(channel.expanderOutput, output, channel.range);
+    }
+    if (channel.controller != NO_CONTROLLER && !channel.claimed)
+    {
+        m_config->controllers[channel.controller].output->setOutput(channel.controllerOutput, output, channel.range);
+    }
+    m_outputListeners.notify(index);
+}
+
+/**
+ * Gives every channel with slewMs or smoothMs a slot in the slew arrays.
+ * Each starts at its current output, which a reload or restart carried
+ * over, so a new target is approached from there instead of jumped to.
+ */
+void PwmEngine::buildSlew()
+{
+    m_slewChannels.clear();
+    m_slewTarget.clear();
+    m_slewValue.clear();
+    m_slewRate.clear();
+    m_slewAlpha.clear();
+    const double frameMs{static_cast<double>(m_config->frameIntervalMs)};
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        const ChannelConfig &settings{m_config->channels[i]};
+        Channel &channel{m_channels[i]};
+        if (settings.slewMs == 0 && settings.smoothMs == 0)
+        {
+            continue;
+        }
+
+        channel.slew = m_slewChannels.size();
+        m_slewChannels.push_back(i);
+        m_slewTarget.push_back(channel.output << SLEW_SHIFT);
+        m_slewValue.push_back(channel.output << SLEW_SHIFT);
+
+        // A whole-range move takes slewMs; without one the rate never limits
+        const long long rate{settings.slewMs > 0
+                                 ? (static_cast<long long>(channel.range) << SLEW_SHIFT) * m_config->frameIntervalMs /
+                                       settings.slewMs
+                                 : std::numeric_limits<std::int32_t>::max()};
+        m_slewRate.push_back(static_cast<std::int32_t>(
+            std::clamp<long long>(rate, 1, std::numeric_limits<std::int32_t>::max())));
+
+        // Covering 1 - e^(-frame / smoothMs) of the distance each frame is a first-order lag
+        const double alpha{settings.smoothMs > 0 ? 1.0 - std::exp(-frameMs / settings.smoothMs) : 1.0};
+        m_slewAlpha.push_back(std::clamp(static_cast<std::int32_t>(std::lround(alpha * 65536.0)), 1, 65536));
+    }
+    m_slewSettled = true;
+}
+
+/**
+ * Moves every smoothed channel one frame towards its target and writes
+ * the ones whose duty changed. The first loop is branch-free integer
+ * maths over the slot arrays with a single store, so it vectorizes; the
+ * exponential step is the distance times the Q16 alpha, then limited to
+ * the rate.
+ */
+void PwmEngine::advanceSlew()
+{
+    if (m_slewSettled)
+    {
+        return;
+    }
+
+    const std::size_t count{m_slewChannels.size()};
+    const std::int32_t *target{m_slewTarget.data()};
+    const std::int32_t *rate{m_slewRate.data()};
+    const std::int32_t *alpha{m_slewAlpha.data()};
+    std::int32_t *value{m_slewValue.data()};
+    std::int32_t remaining{0};
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        const std::int32_t distance{target[i] - value[i]};
+        // |distance| * alpha >> 16 in two 32-bit halves, which vector units multiply
+        // without widening; on the magnitude, so it rounds towards 0 from both sides
+        const auto magnitude{static_cast<std::uint32_t>(distance < 0 ? -distance : distance)};
+        const auto share{static_cast<std::int32_t>((magnitude >> 16) * static_cast<std::uint32_t>(alpha[i]) +
+                                                   (((magnitude & 0xFFFF) * static_cast<std::uint32_t>(alpha[i])) >> 16))};
+        const std::int32_t eased{distance < 0 ? -share : share};
+        const std::int32_t limited{eased > rate[i] ? rate[i] : eased < -rate[i] ? -rate[i] : eased};
+        // The exponential tail rounds to 0 within two duty steps of the target; that bit is taken at once
+        const std::int32_t step{limited == 0 ? distance : limited};
+        value[i] += step;
+        remaining |= distance - step;
+    }
+
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        const std::size_t index{m_slewChannels[i]};
+        const int output{(value[i] + (1 << (SLEW_SHIFT - 1))) >> SLEW_SHIFT};
+        if (output != m_channels[index].output)
+        {
+            commitOutput(index, output);
+        }
+    }
+    m_slewSettled = remaining == 0;
+}
+
+void PwmEngine::releasePin(std::size_t index)
+{
+    Channel &channel{m_channels[index]};
+    channel.claimed = false;
+    writeOutput(index, channel.output);
+    if (channel.strip != NO_STRIP)
+    {
+        m_config->strips[channel.strip].output->setPixel(channel.pixel, channel.color, channel.output, channel.range);
+        m_stripChanged[channel.strip] = true;
+    }
+    if (channel.expander != NO_EXPANDER)
+    {
+        m_config->expanders[channel.expander].output->setOutput(channel.expanderOutput, channel.output, channel.range);
+    }
+    if (channel.controller != NO_CONTROLLER)
+    {
+        m_config->controllers[channel.controller].output->setOutput(channel.controllerOutput, channel.output,
+                                                                    channel.range);
+    }
+}
+
+void PwmEngine::writeOutput(std::size_t index, int duty) const
+{
+    const Channel &channel{m_channels[index]};
+    if (m_hardwareOutput && channel.gpioPin != NO_GPIO)
+    {
+        writePin(channel, duty);
+    }
+}
+
+void PwmEngine::allOff()
+{
+    for (const Channel &channel : m_channels)
+    {
+        if (m_hardwareOutput && channel.gpioPin != NO_GPIO)
+        {
+            writePin(channel, 0);
+        }
+    }
+    for (const StripConfig &strip : m_config->strips)
+    {
+        strip.output->clear();
+        reportOutput(strip.output->show(), false, "Strip", strip.name);
+    }
+    for (const ExpanderConfig &expander : m_config->expanders)
+    {
+        expander.output->allOff();
+    }
+    for (const ControllerConfig &controller : m_config->controllers)
+    {
+        controller.output->allOff();
+    }
+}
+
+void PwmEngine::snapshotOutputs(std::vector<int> &out) const
+{
+    out.resize(m_channels.size());
+    for (std::size_t i{0}; i < m_channels.size(); ++i)
+    {
+        out[i] = m_channels[i].output;
+    }
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <chrono>     // Ambient loop timing
+#include <cstddef>    // std::size_t
+#include <cstdint>    // std::uint32_t colors
+#include <memory>     // Plugin state ownership
+#include <string>     // Channel names
+#include <vector>     // Channel storage
+#include "compositor.h"
+#include "effect_script.h"
+#include "frame_ring.h"
+#include "listener_list.h"
+#include "procedural.h"
+#include "rig_config.h"
+#include "scene.h"
+#include "source_merger.h"
+#include "state_snapshot.h"
+#include "work_pool.h"
+
+// Parent index of the master group
+constexpr std::size_t NO_GROUP{static_cast<std::size_t>(-1)};
+// Strip index of channels that are not an LED of an addressable strip
+constexpr std::size_t NO_STRIP{static_cast<std::size_t>(-1)};
+// Expander index of channels that are not a PCA9685 output
+constexpr std::size_t NO_EXPANDER{static_cast<std::size_t>(-1)};
+// Controller index of channels that are not offloaded to a microcontroller
+constexpr std::size_t NO_CONTROLLER{static_cast<std::size_t>(-1)};
+// Ambient gain of a group that is not dimmed by the ambient loop
+constexpr int AMBIENT_UNITY{4096};
+// Slew index of channels whose output follows its target at once
+constexpr std::size_t NO_SLEW{static_cast<std::size_t>(-1)};
+// Fraction bits of the slew state; outputs up to 65535 still fit an int32
+constexpr int SLEW_SHIFT{15};
+
+/**
+ * A single PWM output channel. duty is the manual level merged from the
+ * slider, scene and external sources (0–range); level is the result of blending all compositor
+ * layers; output is what is actually written to the pin after the group
+ * faders and any slew or smoothing have been applied.
+ */
+struct Channel
+{
+    std::string name;
+    int gpioPin{NO_GPIO};
+    bool manual{false};            // true when the duty is driven from the GUI
+    std::uint32_t color{0xFFFFFF}; // LED color as 0xRRGGBB, used by the preview
+    int range{255};                // Maximum duty value
+    int frequency{0};              // PWM frequency in Hz, 0 = pigpio default
+    bool hardwarePwm{false};       // Driven by the PWM peripheral
+    int duty{0};
+    int level{0};
+    int output{0};
+    std::size_t group{0};          // Innermost group fader (zone or master)
+    std::size_t strip{NO_STRIP};   // Addressable strip (index into the config's strips)
+    std::size_t pixel{0};          // LED position on the strip
+    std::size_t expander{NO_EXPANDER}; // PCA9685 (index into the config's expanders)
+    std::size_t expanderOutput{0};
+    std::size_t controller{NO_CONTROLLER}; // Microcontroller (index into the config's controllers)
+    std::size_t controllerOutput{0};       // Position in the controller's frame
+    std::size_t slew{NO_SLEW};     // Slot in the engine's slew arrays, if the output is smoothed
+    bool dirty{false};             // output must be recomputed this frame
+    bool claimed{false};           // Pin written by a precise effect, not by the engine
+
+    // Pattern settings and state (the former TimerState of the fade)
+    Pattern pattern{Pattern::Manual};
+    int step{2};
+    bool inverted{false};
+    int brightness{0};       // Fade position before inversion (0–range)
+    bool increasing{true};   // Whether the fade is going up or down
+    bool crossfading{false}; // A scene crossfade is blending the pattern's value in
+    ProceduralState procedural{}; // Flicker, fire and twinkle
+};
+
+/**
+ * A group fader: the master, or a zone below it. level scales the outputs
+ * of every channel below the group (255 = unchanged), and so does ambient,
+ * the gain the ambient light loop sets (AMBIENT_UNITY = unchanged).
+ */
+struct Group
+{
+    std::string name;
+    int level{255};
+    std::size_t parent{NO_GROUP};
+    std::vector<std::size_t> channels; // Every channel below this group
+    int ambient{AMBIENT_UNITY};
+};
+
+/**
+ * Owns every PWM channel and pushes duty changes to the GPIO pins.
+ * The GUI never calls gpioPWM directly; it goes through the engine so that
+ * the current duty of every channel can be read back at any time.
+ *
+ * Channels are built from an immutable RigConfig. A new config can be
+ * queued at any time and is swapped in at the start of the next frame.
+ *
+ * The manual layer is merged from several sources (sliders, scenes and any
+ * registered external controller) by priority and per-channel HTP/LTP.
+ *
+ * Large rigs can spread the per-channel patterns and the compositor over a
+ * work-stealing pool (setWorkerThreads); the results are joined and
+ * committed on the calling thread before any output is written.
+ *
+ * Each frame the compositor blends the base, manual, effects and override
+ * layers into one level per channel. Outputs are then computed lazily: a
+ * level or fader change only marks the channels it affects as dirty, and
+ * tick() recomputes and writes just those.
+ */
+class PwmEngine
+{
+public:
+    using ListenerId = std::size_t;
+    using SourceId = SourceMerger::SourceId;
+    // Called with the channel index every time a duty value changes
+    using DutyListener = ListenerList<std::size_t>::Callback;
+    // Called with false before and true after the channel list is rebuilt
+    using LayoutListener = ListenerList<bool>::Callback;
+
+    // Replaces the channel list immediately
+    void applyConfig(RigConfigPtr config);
+
+    // Queues a config to be applied at the start of the next tick()
+    void scheduleConfig(RigConfigPtr config) { m_pendingConfig = std::move(config); }
+
+    // Advances one frame: swaps in a pending config, runs the patterns and
+    // crossfades, then writes the outputs of dirty channels
+    void tick();
+
+    PwmEngine();
+
+    // Sets a channel's value on the GUI source; applied on the next tick()
+    void setDuty(std::size_t index, int duty);
+
+    // Registers another manual source, e.g. an external controller
+    SourceId addSource(std::string name, int priority) { return m_merger.addSource(std::move(name), priority); }
+    void setSourceValue(SourceId source, std::size_t index, int value);
+    void releaseSource(SourceId source, std::size_t index) { m_merger.release(source, index); }
+
+    // Takes frames from another process through shared memory (see frame_ring.h): every tick()
+    // applies the newest one as a manual source; nullptr detaches
+    void setFrameRing(std::unique_ptr<FrameRing> ring);
+    FrameRing *frameRing() const { return m_frameRing.get(); }
+    void setGroupLevel(std::size_t group, int level);
+
+    // Forces channels to a value on the override layer; blackout forces all to 0
+    void setOverride(std::size_t index, int value) { m_compositor.setValue(Layer::Override, index, value); }
+    void clearOverride(std::size_t index) { m_compositor.clearValue(Layer::Override, index); }
+    void setBlackout(bool enabled);
+
+    // Stores every channel's duty and pattern state into scene
+    void captureScene(Scene &scene) const;
+
+    // Moves to a stored scene, instantly (fadeMs == 0) or over fadeMs.
+    // Only channels that differ from the scene take part in the crossfade.
+    void recallScene(const Scene &scene, int fadeMs);
+    bool crossfadeActive() const { return m_crossfadeFrames > 0; }
+
+    // Stores what a restarted engine needs to carry on (see StateSnapshot)
+    void captureState(EngineState &state) const;
+    // Hands saved state to the next applyConfig(): channels and groups it does not carry
+    // over from the running config start where the state left them, not at 0
+    void restoreState(EngineState state) { m_restore = std::move(state); }
+
+    // Duty listeners see requested duties; output listeners see pin writes
+    ListenerId addDutyListener(DutyListener listener) { return m_dutyListeners.add(std::move(listener)); }
+    void removeDutyListener(ListenerId id) { m_dutyListeners.remove(id); }
+    ListenerId addOutputListener(DutyListener listener) { return m_outputListeners.add(std::move(listener)); }
+    void removeOutputListener(ListenerId id) { m_outputListeners.remove(id); }
+    ListenerId addLayoutListener(LayoutListener listener) { return m_layoutListeners.add(std::move(listener)); }
+    void removeLayoutListener(ListenerId id) { m_layoutListeners.remove(id); }
+
+    // Hands a channel's pin to a precise effect (see precise_effects.h). The
+    // output is still computed and reported, but no longer written.
+    void claimPin(std::size_t index) { m_channels[index].claimed = true; }
+    // Gives the pin back and writes the current output to it
+    void releasePin(std::size_t index);
+    // Writes a duty straight to a channel's GPIO pin (other outputs are left
+    // alone); safe from the effect thread as long as the channel list is not
+    // rebuilt meanwhile
+    void writeOutput(std::size_t index, int duty) const;
+
+    // The ambient light loop's state, or nullptr if the config has none
+    const AmbientStats *ambientStats() const { return m_ambient ? &m_ambient->stats() : nullptr; }
+
+    // Threads (including the caller) that evaluate frames of large rigs; 1 = inline
+    void setWorkerThreads(std::size_t threads);
+    std::size_t workerThreads() const { return m_pool ? m_pool->threadCount() : 1; }
+
+    // Disables all GPIO writes, for running without pigpio (e.g. in CI)
+    void setHardwareOutput(bool enabled) { m_hardwareOutput = enabled; }
+
+    // Turns every channel off, used when the application exits
+    void allOff();
+
+    // Copies every channel output into out (resized to channelCount())
+    void snapshotOutputs(std::vector<int> &out) const;
+
+    const Channel &channel(std::size_t index) const { return m_channels[index]; }
+    std::size_t channelCount() const { return m_channels.size(); }
+    const Group &group(std::size_t index) const { return m_groups[index]; }
+    std::size_t groupCount() const { return m_groups.size(); }
+    const RigConfig &config() const { return *m_config; }
+
+private:
+    // Channels sharing one compiled expression, evaluated a batch at a time
+    struct ExpressionGroup
+    {
+        const Expression *expression;
+        std::vector<std::size_t> channels;
+        std::vector<float> index; // The i and r inputs, in channel order
+        std::vector<float> range;
+    };
+
+    // Channels driven by one plugin, passed to it as a single batch
+    struct PluginGroup
+    {
+        std::shared_ptr<const EffectPlugin> plugin; // Outlives state, which its destroy() frees
+        std::unique_ptr<void, void (*)(void *)> state;
+        std::vector<std::size_t> channels;
+        std::vector<std::uint32_t> index;
+        std::vector<std::int32_t> range;
+        std::vector<std::int32_t> out;
+    };
+
+    // A slice of m_taskChannels: one zone, or part of a large one
+    struct ZoneTask
+    {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // One channel of a running crossfade
+    struct CrossfadeStep
+    {
+        std::size_t channel;
+        int from;       // Duty at the recall
+        int effectFrom; // Effects layer value at the recall (0 if manual), -1 if neither side has a pattern
+        SceneChannel to;
+    };
+
+    void buildGroups();
+    void buildStrips();
+    void paintStrips();
+    void showStrips();
+    void buildExpanders();
+    void paintExpanders();
+    void flushExpanders();
+    void buildControllers();
+    void paintControllers();
+    void flushControllers();
+    void buildAmbient();
+    void advanceAmbient();
+    void setAmbientGain(double gain);
+    void resetCompositor(const std::vector<int> &effects);
+    void consumeFrameRing();
+    void mergeSources();
+    void compose();
+    void setupPin(const Channel &channel);
+    void writePin(const Channel &channel, int duty) const;
+    void markDirty(std::size_t index);
+    void flushOutputs();
+    void commitOutput(std::size_t index, int output);
+    void buildSlew();
+    void advanceSlew();
+    int effectiveOutput(const Channel &channel) const;
+    void buildZoneTasks();
+    bool parallel() const;
+    void evaluatePatterns();
+    int advancePattern(std::size_t index);
+    int advanceFade(std::size_t index);
+    void startScript(std::size_t index);
+    void buildExpressionGroups();
+    void advanceExpressions();
+    void buildPluginGroups();
+    void advancePlugins();
+    void setEffectValue(std::size_t index, int value);
+    void applyScenePattern(std::size_t index, const SceneChannel &target);
+    void advanceCrossfade();
+    void finishCrossfadeStep(const CrossfadeStep &step);
+
+    RigConfigPtr m_config{std::make_shared<const RigConfig>()};
+    RigConfigPtr m_pendingConfig;
+    EngineState m_restore;                 // Consumed by the next applyConfig()
+    std::vector<Channel> m_channels;
+    std::vector<Group> m_groups;           // [0] is the master
+    std::vector<std::size_t> m_dirty;      // Channels to recompute, reserved per config
+    SourceMerger m_merger;
+    SourceId m_guiSource;
+    SourceId m_sceneSource;
+    SourceId m_ringSource;
+    std::unique_ptr<FrameRing> m_frameRing;
+    std::vector<int> m_ringValues;         // Last value taken from the ring per channel, -1 = none
+    EffectScheduler m_scripts;
+    std::vector<ExpressionGroup> m_expressionGroups;
+    std::vector<PluginGroup> m_pluginGroups;
+    double m_time{0.0}; // Seconds of engine frames so far, the t of expressions and plugins
+    Compositor m_compositor;
+    std::vector<std::uint32_t> m_levels;   // Compositor output of the current frame
+    std::vector<bool> m_stripChanged;      // Strips with an LED changed this frame
+    std::vector<bool> m_stripFailing;      // Strips whose last frame failed, already reported
+    std::vector<bool> m_expanderFailing;   // The same for expanders
+    std::vector<bool> m_controllerFailing; // and controllers
+
+    std::unique_ptr<AmbientController> m_ambient; // Only with an ambient loop in the config
+    std::size_t m_ambientGroup{0};         // Group whose ambient gain the loop sets
+    int m_ambientFrames{1};                // Frames per control step
+    int m_ambientFrame{0};
+    std::chrono::steady_clock::time_point m_ambientLastStep;
+
+    // Channels with slewMs or smoothMs, one slot each. The state is kept in parallel
+    // Q15 arrays so advanceSlew() runs one branch-free loop the compiler can vectorize.
+    std::vector<std::size_t> m_slewChannels;
+    std::vector<std::int32_t> m_slewTarget; // Output the channel is heading for
+    std::vector<std::int32_t> m_slewValue;  // Where it is now
+    std::vector<std::int32_t> m_slewRate;   // Most it moves per frame
+    std::vector<std::int32_t> m_slewAlpha;  // Share of the distance it covers per frame, Q16
+    bool m_slewSettled{true};               // Every value is at its target
+
+    std::unique_ptr<WorkPool> m_pool;      // Only with more than one thread
+    std::vector<std::size_t> m_taskChannels; // Channel indices grouped by zone
+    std::vector<ZoneTask> m_zoneTasks;
+    std::vector<int> m_effectStaging;      // Pattern results of a parallel frame, -1 = none
+
+    // Crossfade in progress; reserved per config, so starting one doesn't allocate
+    std::vector<CrossfadeStep> m_crossfade;
+    std::vector<int> m_crossfadeLive;      // This frame's pattern value of crossfading channels, -1 = none
+    int m_crossfadeFrame{0};
+    int m_crossfadeFrames{0};
+
+    ListenerList<std::size_t> m_dutyListeners;
+    ListenerList<std::size_t> m_outputListeners;
+    ListenerList<bool> m_layoutListeners;
+    bool m_hardwareOutput{true};
+};
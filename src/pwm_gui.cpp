@@ -1,24 +1,92 @@
-#include <QApplication> // Qt application and event loop
-#include <QWidget>      // Base class for all GUI windows
-#include <QSlider>      // Slider widget for brightness control
-#include <QLabel>       // Labels for LED names
-#include <QPushButton>  // Exit button
-#include <QVBoxLayout>  // Vertical layout manager
-#include <QHBoxLayout>  // Horizontal layout for labels and sliders
-#include <QFont>        // Font customization
-#include <QPalette>     // GUI background color
-#include <QTimer>       // Timer for SIT730 automatic intensity modulation
-#include <memory>       // std::unique_ptr and std::shared_ptr for smart memory management
-#include <stdexcept>    // For throwing runtime errors
-#include <pigpio.h>     // Raspberry Pi GPIO control (PWM)
-
-// GPIO pin numbers connected to respective LEDs
-constexpr int RED_LED{17};
-constexpr int GREEN_LED{27};
-constexpr int BLUE_LED{22};
+#include <QApplication>       // Qt application and event loop
+#include <QWidget>            // Base class for all GUI windows
+#include <QPushButton>        // Exit and scene buttons
+#include <QVBoxLayout>        // Vertical layout manager
+#include <QHBoxLayout>        // Horizontal layout for the scene controls
+#include <QComboBox>          // Scene name selection
+#include <QSpinBox>           // Crossfade time
+#include <QFont>              // Font customization
+#include <QPalette>           // GUI background color
+#include <QTimer>             // Frame timer for SIT730 automatic intensity modulation
+#include <QCommandLineParser> // Command line options
+#include <QElapsedTimer>      // Startup time measurement
+#include <QFile>              // Reading /proc/self/status for memory usage
+#include <QSignalBlocker>     // Unchecking effect buttons without side effects
+#include <QPointer>           // Plugin watchers that may already be deleted
+#include <QDir>               // Creating the state file's directory
+#include <QFileInfo>          // Directory of the state file
+#include <QStandardPaths>     // Default state file location
+#include <algorithm>          // std::max, std::min
+#include <functional>         // Plugin watcher setup, called again on reload
+#include <set>                // Distinct plugin paths
+#include <chrono>             // Strobe and chase timing
+#include <csignal>            // Ignoring SIGPIPE from strip FIFOs
+#include <memory>             // std::unique_ptr and std::shared_ptr for smart memory management
+#include <stdexcept>          // For throwing runtime errors
+#include <string>             // Configuration file path
+#include <thread>             // Core count for the default worker threads
+#include <utility>            // std::move
+#include <vector>             // Channel lists of the precise effects
+#include <pigpio.h>           // Raspberry Pi GPIO control (PWM)
+#include "pwm_engine.h"       // Channel storage and PWM output
+#include "channel_model.h"    // Model exposing channels to the view
+#include "channel_delegate.h" // Widget-free painting of channel sliders
+#include "channel_view.h"     // Virtualized channel list
+#include "led_preview.h"      // Live color/duty preview of all channels
+#include "duty_scope.h"       // Scrolling duty history of the physical LEDs
+#include "ui_profile.h"       // Local vs. X11-forwarded repaint budget
+#include "kiosk.h"            // Framebuffer/evdev platform setup
+#include "latency_probe.h"    // Synthetic input-to-pin latency measurement
+#include "rig_config.h"       // Channel/pin configuration file
+#include "config_watcher.h"   // inotify-based config hot reload
+#include "scene.h"            // Stored scene presets
+#include "group_panel.h"      // Master and zone faders
+#include "state_snapshot.h"   // Warm restart from the last saved state
+#include "effect_bench.h"     // Procedural pattern throughput
+#include "precise_effects.h"  // Strobe and chase on absolute deadlines
+#include "output_bench.h"     // LED strip, expander, offload and frame ring throughput
+#include "offload_protocol.h" // Channel limit of the offload bench
+
+// Number of scene presets that can be stored; all slots are allocated at startup
+constexpr std::size_t MAX_SCENES{32};
+
+// Frames timed per pattern by --effect-bench
+constexpr int EFFECT_BENCH_FRAMES{2000};
+// Frames encoded per chip by --strip-bench
+constexpr int STRIP_BENCH_FRAMES{2000};
+// --scaling-bench runs on 1 up to this many threads
+constexpr int SCALING_BENCH_THREADS{4};
+// Channels and slots of the --frame-ring; room to spare for rigs that grow on reload
+constexpr std::size_t FRAME_RING_CHANNELS{4096};
+constexpr std::size_t FRAME_RING_SLOTS{4};
+// Seconds of engine time run by --ambient-bench
+constexpr int AMBIENT_BENCH_SECONDS{120};
+// How often the ambient light loop reports how it is doing
+constexpr int AMBIENT_REPORT_INTERVAL_MS{10000};
+// How often the engine state is saved for a warm restart
+constexpr int STATE_SAVE_INTERVAL_MS{1000};
+// Default --threads: one core stays free for the GUI and pigpio
+constexpr unsigned MAX_DEFAULT_WORKER_THREADS{3};
+
+// Strobe and chase buttons: a 10 Hz flash and a 10 steps/s chase
+constexpr std::chrono::milliseconds STROBE_ON_TIME{10};
+constexpr std::chrono::milliseconds STROBE_OFF_TIME{90};
+constexpr std::chrono::milliseconds CHASE_STEP_TIME{100};
+// --strobe-probe flashes at 500 Hz, well below the frame timer's granularity
+constexpr std::chrono::microseconds PROBE_STROBE_TIME{1000};
 
 /**
- * Initializes pigpio and sets GPIO pins as output.
+ * Worker threads used without --threads: all but one core, at most
+ * MAX_DEFAULT_WORKER_THREADS (three on a Pi 4).
+ */
+unsigned defaultWorkerThreads()
+{
+    const unsigned cores{std::thread::hardware_concurrency()};
+    return std::max(1u, std::min(MAX_DEFAULT_WORKER_THREADS, cores > 1 ? cores - 1 : 1u));
+}
+
+/**
+ * Initializes pigpio. Pins are set up by the engine from the configuration.
  */
 void setupGpio()
 {
@@ -26,50 +94,59 @@ void setupGpio()
     {
         throw std::runtime_error{"GPIO initialization failed"};
     }
-    gpioSetMode(RED_LED, PI_OUTPUT);
-    gpioSetMode(GREEN_LED, PI_OUTPUT);
-    gpioSetMode(BLUE_LED, PI_OUTPUT);
 }
 
 /**
- * Creates a single LED slider widget used for PWM brightness control.
- * This version is used only for the Red LED (manual control).
+ * Where the state is saved without --state: in the user's cache directory.
+ * It is only created when the snapshot is opened.
  */
-std::unique_ptr<QWidget> createLedSlider(const QString &labelText, int gpioPin)
+QString defaultStatePath()
 {
-    auto label{std::make_unique<QLabel>(labelText)};
-    label->setFont(QFont{"Arial", 11});
-    label->setStyleSheet("QLabel { color: white; }");
-
-    auto slider{std::make_unique<QSlider>(Qt::Horizontal)};
-    slider->setRange(0, 255); // Range for PWM (duty cycle)
-    slider->setValue(0);      // Default off
-
-    // Connect slider movement to update the LED brightness using PWM
-    QObject::connect(slider.get(), &QSlider::valueChanged, [gpioPin](int value)
-                     { gpioPWM(gpioPin, value); });
-
-    auto layout{std::make_unique<QHBoxLayout>()};
-    layout->addWidget(label.get());
-    layout->addWidget(slider.get());
-
-    auto container{std::make_unique<QWidget>()};
-    container->setLayout(layout.release());
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/state.bin";
+}
 
-    label.release();
-    slider.release();
+/**
+ * Creates the channel panel: a virtualized list where each row shows
+ * a channel name and its duty slider. Rows are painted on demand, so
+ * only the visible channels cost anything to draw.
+ */
+std::unique_ptr<QWidget> createChannelPanel(PwmEngine &engine, const UiProfile &profile)
+{
+    auto view{std::make_unique<ChannelView>()};
+    auto *model{new ChannelModel{engine, view.get()}}; // Owned by the view
+    model->setFlushInterval(profile.modelFlushMs);
+    view->setModel(model);
+    view->setItemDelegate(new ChannelDelegate{view.get()}); // Owned by the view
+    return view;
+}
 
-    return container;
+/**
+ * Applies the grey button look. Over a forwarded display the palette is
+ * used instead of a style sheet.
+ */
+void styleButton(QPushButton &button, const UiProfile &profile)
+{
+    button.setFont(QFont{"Arial", 12});
+    if (profile.styleSheets)
+    {
+        button.setStyleSheet("QPushButton { background-color: grey; color: white; padding: 5px; }");
+    }
+    else
+    {
+        QPalette palette{button.palette()};
+        palette.setColor(QPalette::Button, Qt::gray);
+        palette.setColor(QPalette::ButtonText, Qt::white);
+        button.setPalette(palette);
+    }
 }
 
 /**
  * Creates an Exit button that shuts down the GUI application cleanly.
  */
-std::unique_ptr<QPushButton> createExitButton()
+std::unique_ptr<QPushButton> createExitButton(const UiProfile &profile)
 {
     auto button{std::make_unique<QPushButton>("Exit")};
-    button->setFont(QFont{"Arial", 12});
-    button->setStyleSheet("QPushButton { background-color: grey; color: white; padding: 5px; }");
+    styleButton(*button, profile);
 
     QObject::connect(button.get(), &QPushButton::clicked, []()
                      { QApplication::quit(); });
@@ -78,55 +155,193 @@ std::unique_ptr<QPushButton> createExitButton()
 }
 
 /**
- * Creates a QTimer that automatically adjusts the brightness of
- * GREEN and BLUE LEDs to create a continuous fading effect.
- * GREEN and BLUE will have opposing brightness patterns.
+ * Creates a Blackout toggle that forces every output to 0 through the
+ * override layer, without touching sliders, patterns or scenes.
+ */
+std::unique_ptr<QPushButton> createBlackoutButton(PwmEngine &engine, const UiProfile &profile)
+{
+    auto button{std::make_unique<QPushButton>("Blackout")};
+    styleButton(*button, profile);
+    button->setCheckable(true);
+
+    QObject::connect(button.get(), &QPushButton::toggled, [&engine](bool checked)
+                     { engine.setBlackout(checked); });
+
+    return button;
+}
+
+/**
+ * The channels the strobe and chase run on: every channel with a pin, or
+ * on a rig without pins the simulated channels, which have no output at
+ * all. Strip, expander and controller channels are written once per frame
+ * by the engine, so the timing thread cannot drive them.
  */
-void setupAutoIntensityTimer(const std::shared_ptr<QWidget> &parent)
+std::vector<std::size_t> effectChannels(const PwmEngine &engine)
 {
-    // This struct holds the current brightness level and direction
-    // and is shared across timer executions using a shared_ptr.
-    struct TimerState
+    std::vector<std::size_t> channels;
+    for (std::size_t i{0}; i < engine.channelCount(); ++i)
+    {
+        if (engine.channel(i).gpioPin != NO_GPIO)
+        {
+            channels.push_back(i);
+        }
+    }
+    if (channels.empty())
     {
-        int brightness{0};     // PWM value for GREEN LED (0–255)
-        bool increasing{true}; // Flag to track whether we're fading up or down
-    };
+        for (std::size_t i{0}; i < engine.channelCount(); ++i)
+        {
+            const Channel &channel{engine.channel(i)};
+            if (channel.strip == NO_STRIP && channel.expander == NO_EXPANDER && channel.controller == NO_CONTROLLER)
+            {
+                channels.push_back(i);
+            }
+        }
+    }
+    return channels;
+}
+
+/**
+ * Creates the "Strobe" and "Chase" toggles. Only one effect runs at a time,
+ * so checking one unchecks the other; a config reload stops the effect and
+ * unchecks both. Both are disabled while no channel can run them.
+ */
+std::unique_ptr<QWidget> createPreciseEffectButtons(PwmEngine &engine, PreciseEffects &effects,
+                                                    const UiProfile &profile)
+{
+    auto strobeButton{std::make_unique<QPushButton>("Strobe")};
+    auto chaseButton{std::make_unique<QPushButton>("Chase")};
+    styleButton(*strobeButton, profile);
+    styleButton(*chaseButton, profile);
+    strobeButton->setCheckable(true);
+    chaseButton->setCheckable(true);
+
+    QPushButton *strobe{strobeButton.get()};
+    QPushButton *chase{chaseButton.get()};
+    QObject::connect(strobe, &QPushButton::toggled, [&engine, &effects, chase](bool checked)
+                     {
+        if (checked) {
+            const QSignalBlocker blocker{chase};
+            chase->setChecked(false);
+            effects.startStrobe(effectChannels(engine), STROBE_ON_TIME, STROBE_OFF_TIME);
+        } else {
+            effects.stop();
+        } });
+    QObject::connect(chase, &QPushButton::toggled, [&engine, &effects, strobe](bool checked)
+                     {
+        if (checked) {
+            const QSignalBlocker blocker{strobe};
+            strobe->setChecked(false);
+            effects.startChase(effectChannels(engine), CHASE_STEP_TIME);
+        } else {
+            effects.stop();
+        } });
+
+    auto panel{std::make_unique<QWidget>()};
+    const bool usable{!effectChannels(engine).empty()};
+    strobe->setEnabled(usable);
+    chase->setEnabled(usable);
+    const PwmEngine::ListenerId listenerId{engine.addLayoutListener([&engine, strobe, chase](bool rebuilt)
+                                                                    {
+        if (!rebuilt) {
+            const QSignalBlocker strobeBlocker{strobe};
+            const QSignalBlocker chaseBlocker{chase};
+            strobe->setChecked(false);
+            chase->setChecked(false);
+        } else {
+            const bool usable{!effectChannels(engine).empty()};
+            strobe->setEnabled(usable);
+            chase->setEnabled(usable);
+        } })};
+    QObject::connect(panel.get(), &QObject::destroyed, [&engine, listenerId]()
+                     { engine.removeLayoutListener(listenerId); });
+
+    auto layout{std::make_unique<QHBoxLayout>()};
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(strobeButton.release());
+    layout->addWidget(chaseButton.release());
+    panel->setLayout(layout.release());
+    return panel;
+}
+
+/**
+ * Creates the scene controls: a name box, "Store" to capture the current
+ * look under that name, and "Go" to recall it with the chosen crossfade
+ * time (0 ms switches instantly).
+ */
+std::unique_ptr<QWidget> createScenePanel(PwmEngine &engine, SceneStore &scenes, const UiProfile &profile)
+{
+    auto names{std::make_unique<QComboBox>()};
+    names->setEditable(true);
+    names->setInsertPolicy(QComboBox::NoInsert); // Added on "Store" instead
+    names->setCurrentText("Scene 1");
+
+    auto fadeTime{std::make_unique<QSpinBox>()};
+    fadeTime->setRange(0, 60000);
+    fadeTime->setSingleStep(250);
+    fadeTime->setSuffix(" ms");
+    fadeTime->setValue(1000);
+
+    auto storeButton{std::make_unique<QPushButton>("Store")};
+    auto goButton{std::make_unique<QPushButton>("Go")};
+    styleButton(*storeButton, profile);
+    styleButton(*goButton, profile);
+
+    QComboBox *nameBox{names.get()};
+    QSpinBox *fadeBox{fadeTime.get()};
+    QObject::connect(storeButton.get(), &QPushButton::clicked, [&engine, &scenes, nameBox]()
+                     {
+        const QString name{nameBox->currentText().trimmed()};
+        if (name.isEmpty()) {
+            return;
+        }
+        try {
+            engine.captureScene(scenes.slot(name.toStdString()));
+            if (nameBox->findText(name) < 0) {
+                nameBox->addItem(name);
+            }
+        } catch (const std::exception &ex) {
+            qWarning("Cannot store scene: %s", ex.what());
+        } });
+    QObject::connect(goButton.get(), &QPushButton::clicked, [&engine, &scenes, nameBox, fadeBox]()
+                     {
+        if (const Scene *scene{scenes.find(nameBox->currentText().trimmed().toStdString())}) {
+            engine.recallScene(*scene, fadeBox->value());
+        } });
+
+    auto layout{std::make_unique<QHBoxLayout>()};
+    layout->addWidget(names.release(), 1);
+    layout->addWidget(fadeTime.release());
+    layout->addWidget(storeButton.release());
+    layout->addWidget(goButton.release());
 
-    // Shared state object between QTimer and lambda — needed so brightness
-    // can be updated and remembered across timeouts.
-    auto state{std::make_shared<TimerState>()};
+    auto container{std::make_unique<QWidget>()};
+    container->setLayout(layout.release());
+    return container;
+}
 
+/**
+ * Creates a QTimer that runs the engine frame by frame. Each frame the
+ * fading channels (GREEN and BLUE by default, with opposing brightness)
+ * take one step, and a reloaded configuration is swapped in if pending.
+ */
+void setupAutoIntensityTimer(const std::shared_ptr<QWidget> &parent, PwmEngine &engine)
+{
     // Create the timer with the given parent (which manages its memory).
     // The parent ensures the timer is properly cleaned up when GUI closes.
     auto timer{std::make_unique<QTimer>(parent.get())};
+    QTimer *frameTimer{timer.get()};
 
-    // Every 20ms, this lambda runs to update LED brightness via PWM.
-    QObject::connect(timer.get(), &QTimer::timeout, [state]()
+    // Every frame (20ms by default), advance the patterns of all channels.
+    QObject::connect(timer.get(), &QTimer::timeout, [&engine, frameTimer]()
                      {
-        // Set brightness of GREEN LED directly, and BLUE LED inversely
-        // This gives a "see-saw" brightness effect between the two LEDs.
-        gpioPWM(GREEN_LED, state->brightness);
-        gpioPWM(BLUE_LED, 255 - state->brightness);
-
-        // Adjust brightness smoothly based on direction.
-        constexpr int step{2};  // Smaller step = smoother fade animation
-
-        if (state->increasing) {
-            state->brightness += step;
-            if (state->brightness >= 255) {
-                state->brightness = 255;         // Cap max value
-                state->increasing = false;       // Start fading down
-            }
-        } else {
-            state->brightness -= step;
-            if (state->brightness <= 0) {
-                state->brightness = 0;           // Cap min value
-                state->increasing = true;        // Start fading up
-            }
+        engine.tick();
+
+        // A reload may have changed the frame period
+        if (frameTimer->interval() != engine.config().frameIntervalMs) {
+            frameTimer->setInterval(engine.config().frameIntervalMs);
         } });
 
-    // Start the timer: this will call the lambda every 20ms
-    timer->start(20);
+    timer->start(engine.config().frameIntervalMs);
 
     // We release ownership because the parent (main window) now owns the timer
     timer.release(); // Prevents double deletion
@@ -134,14 +349,23 @@ void setupAutoIntensityTimer(const std::shared_ptr<QWidget> &parent)
 
 /**
  * Builds the complete GUI:
- * - Red LED is manually controlled with a slider.
- * - Green and Blue LEDs are controlled by the automated timer.
+ * - Manual channels (Red LED by default) are controlled with a slider.
+ * - Fading channels (Green and Blue by default) are driven by the frame timer.
+ * - Any extra (simulated) channels appear as additional manual rows.
+ * - A live preview above the sliders shows what every LED is doing.
+ * - A scrolling scope plots the duty history of the physical LEDs.
+ * - Master and zone faders scale every channel below them.
+ * - Scene controls store and recall complete looks.
+ * - Blackout forces every output to 0 until it is released.
+ * - Strobe and chase flash the LEDs from their own timing thread.
  */
-std::unique_ptr<QWidget> createGui()
+std::unique_ptr<QWidget> createGui(PwmEngine &engine, PreciseEffects &effects, SceneStore &scenes,
+                                   const UiProfile &profile)
 {
     auto window{std::make_unique<QWidget>()};
     window->setWindowTitle("PWM LED Brightness Controller");
-    window->setFixedSize(440, 200);
+    window->setMinimumSize(440, 400);
+    window->resize(440, 400);
 
     // Set dark theme background
     QPalette palette{window->palette()};
@@ -149,54 +373,430 @@ std::unique_ptr<QWidget> createGui()
     window->setAutoFillBackground(true);
     window->setPalette(palette);
 
-    // Only red LED has manual control
-    auto redSlider{createLedSlider("Red LED", RED_LED)};
-    auto exitButton{createExitButton()};
+    auto preview{std::make_unique<LedPreview>(engine)};
+    if (profile.previewRefreshMs > 0)
+    {
+        preview->setRefreshInterval(profile.previewRefreshMs);
+    }
+
+    auto scope{std::make_unique<DutyScope>(engine)};
+    scope->setScrollInterval(profile.scopeScrollMs);
+
+    auto channelPanel{createChannelPanel(engine, profile)};
+    auto groupPanel{std::make_unique<GroupPanel>(engine)};
+    auto scenePanel{createScenePanel(engine, scenes, profile)};
+    auto blackoutButton{createBlackoutButton(engine, profile)};
+    auto effectButtons{createPreciseEffectButtons(engine, effects, profile)};
+    auto exitButton{createExitButton(profile)};
+    auto buttonLayout{std::make_unique<QHBoxLayout>()};
     auto layout{std::make_unique<QVBoxLayout>()};
 
-    layout->addWidget(redSlider.release()); // Red LED slider widget
-    layout->addWidget(exitButton.get());    // Exit button
-    layout->setAlignment(exitButton.get(), Qt::AlignCenter);
-    layout->addStretch();
+    layout->addWidget(preview.release());         // LED preview
+    layout->addWidget(scope.release());           // Duty history
+    layout->addWidget(channelPanel.release(), 1); // Channel list takes the spare space
+    layout->addWidget(groupPanel.release());      // Master and zone faders
+    layout->addWidget(scenePanel.release());      // Scene presets
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(blackoutButton.release()); // Blackout toggle
+    buttonLayout->addWidget(effectButtons.release());  // Strobe and chase toggles
+    buttonLayout->addWidget(exitButton.release());     // Exit button
+    buttonLayout->addStretch();
+    layout->addLayout(buttonLayout.release());
 
-    exitButton.release();
     window->setLayout(layout.release());
 
-    // Set up automated PWM modulation for Green and Blue LEDs only
+    // Set up automated PWM modulation for the fading channels
     std::shared_ptr<QWidget> sharedWindow(window.get(), [](QWidget *) {});
-    setupAutoIntensityTimer(sharedWindow);
+    setupAutoIntensityTimer(sharedWindow, engine);
 
     return window;
 }
 
+/**
+ * Returns the resident set size of this process in kB, or -1 if unknown.
+ */
+long residentMemoryKb()
+{
+    QFile status{"/proc/self/status"};
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return -1;
+    }
+
+    while (!status.atEnd())
+    {
+        const QByteArray line{status.readLine()};
+        if (line.startsWith("VmRSS:"))
+        {
+            return line.mid(6).trimmed().split(' ').first().toLong();
+        }
+    }
+    return -1;
+}
+
 /**
  * Main entry point. Initializes GPIO and starts the Qt GUI loop.
+ * Pass --channels N to add N simulated channels for scale testing.
+ * The remote (low-bandwidth) UI is used automatically over ssh -X, or can be
+ * forced with --remote / --local.
+ * --kiosk runs full screen on linuxfb/eglfs with evdev touch input, and
+ * --simulate runs without pigpio so the GUI can be measured anywhere.
+ * --config loads the channels from a JSON file and reloads it when edited.
  */
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
+    // The platform plugin is chosen when QApplication is constructed
+    const bool kiosk{kioskRequested(argc, argv)};
+    if (kiosk)
+    {
+        configureKioskPlatform();
+    }
+
     QApplication app{argc, argv};
 
+    // A strip device may be a FIFO; if its reader goes away the write fails
+    // instead of the process being killed
+    std::signal(SIGPIPE, SIG_IGN);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption channelsOption{"channels", "Add <count> simulated channels.", "count", "0"};
+    parser.addOption(channelsOption);
+    const QCommandLineOption remoteOption{"remote", "Use the low-bandwidth UI for forwarded X11 displays."};
+    parser.addOption(remoteOption);
+    const QCommandLineOption localOption{"local", "Use the full UI even on a forwarded display."};
+    parser.addOption(localOption);
+    const QCommandLineOption kioskOption{"kiosk", "Run full screen on linuxfb/eglfs with evdev touch input."};
+    parser.addOption(kioskOption);
+    const QCommandLineOption simulateOption{"simulate", "Run without GPIO access (no pigpio)."};
+    parser.addOption(simulateOption);
+    const QCommandLineOption latencyOption{"latency-probe", "Measure input-to-pin latency over <presses>, then exit.",
+                                           "presses"};
+    parser.addOption(latencyOption);
+    const QCommandLineOption configOption{"config", "Load channels from a JSON <file> and reload it on change.",
+                                          "file"};
+    parser.addOption(configOption);
+    const QCommandLineOption effectBenchOption{"effect-bench", "Time the patterns on <channels> simulated channels, then exit.",
+                                               "channels"};
+    parser.addOption(effectBenchOption);
+    const QCommandLineOption threadsOption{"threads", "Evaluate large rigs on <n> threads (1 = inline).", "n",
+                                           QString::number(defaultWorkerThreads())};
+    parser.addOption(threadsOption);
+    const QCommandLineOption scalingBenchOption{"scaling-bench", "Time a zoned rig of <channels> on 1 to 4 threads, then exit.",
+                                                "channels"};
+    parser.addOption(scalingBenchOption);
+    const QCommandLineOption stripBenchOption{"strip-bench", "Time the LED strip encoders on <leds> LEDs, then exit.",
+                                              "leds"};
+    parser.addOption(stripBenchOption);
+    const QCommandLineOption expanderBenchOption{"expander-bench", "Run <channels> on fake PCA9685s and report the I2C traffic, then exit.",
+                                                 "channels"};
+    parser.addOption(expanderBenchOption);
+    const QCommandLineOption offloadBenchOption{"offload-bench", "Stream <channels> through a pty to the reference receiver and report bandwidth and latency, then exit.",
+                                                "channels"};
+    parser.addOption(offloadBenchOption);
+    const QCommandLineOption frameRingOption{"frame-ring", "Take frames from other processes through the shared-memory ring <name>.",
+                                             "name"};
+    parser.addOption(frameRingOption);
+    const QCommandLineOption ambientBenchOption{"ambient-bench", "Run the ambient light loop on <channels> in a simulated room and report its timing and settling, then exit.",
+                                                "channels"};
+    parser.addOption(ambientBenchOption);
+    const QCommandLineOption slewBenchOption{"slew-bench", "Move <channels> with 10 Hz slider events, instantly and with slew and smoothing, and report the cost and largest step per frame, then exit.",
+                                             "channels"};
+    parser.addOption(slewBenchOption);
+    const QCommandLineOption stateOption{"state", "Save the engine state to <file> every second and restore it on start (\"\" = off).",
+                                         "file", defaultStatePath()};
+    parser.addOption(stateOption);
+    const QCommandLineOption ringBenchOption{"ring-bench", "Feed <channels> from a producer process through a frame ring and report the latency, then exit.",
+                                             "channels"};
+    parser.addOption(ringBenchOption);
+    const QCommandLineOption strobeProbeOption{"strobe-probe", "Strobe for <edges> and report the edge timing error, then exit.",
+                                               "edges"};
+    parser.addOption(strobeProbeOption);
+    parser.process(app);
+
+    // Every bench needs a positive count; 0 or a typo would divide by zero in the bench
+    for (const QCommandLineOption *bench : {&effectBenchOption, &stripBenchOption, &expanderBenchOption,
+                                            &offloadBenchOption, &ambientBenchOption, &slewBenchOption,
+                                            &ringBenchOption, &scalingBenchOption})
+    {
+        bool valid{false};
+        if (parser.isSet(*bench) && (parser.value(*bench).toInt(&valid) <= 0 || !valid))
+        {
+            qCritical("--%s needs a positive count, not \"%s\"", qPrintable(bench->names().first()),
+                      qPrintable(parser.value(*bench)));
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(effectBenchOption))
+    {
+        runEffectBenchmark(parser.value(effectBenchOption).toInt(), EFFECT_BENCH_FRAMES);
+        return 0;
+    }
+    if (parser.isSet(stripBenchOption))
+    {
+        runStripBenchmark(parser.value(stripBenchOption).toInt(), STRIP_BENCH_FRAMES);
+        return 0;
+    }
+    if (parser.isSet(expanderBenchOption))
+    {
+        runExpanderBenchmark(parser.value(expanderBenchOption).toInt(), EFFECT_BENCH_FRAMES);
+        return 0;
+    }
+    if (parser.isSet(offloadBenchOption))
+    {
+        if (parser.value(offloadBenchOption).toInt() > OFFLOAD_MAX_CHANNELS)
+        {
+            qCritical("--offload-bench takes at most %d channels, the most one controller drives", OFFLOAD_MAX_CHANNELS);
+            return 1;
+        }
+        runOffloadBenchmark(parser.value(offloadBenchOption).toInt(), EFFECT_BENCH_FRAMES);
+        return 0;
+    }
+    if (parser.isSet(ambientBenchOption))
+    {
+        runAmbientBenchmark(parser.value(ambientBenchOption).toInt(), AMBIENT_BENCH_SECONDS);
+        return 0;
+    }
+    if (parser.isSet(slewBenchOption))
+    {
+        runSlewBenchmark(parser.value(slewBenchOption).toInt(), EFFECT_BENCH_FRAMES);
+        return 0;
+    }
+    if (parser.isSet(ringBenchOption))
+    {
+        runFrameRingBenchmark(parser.value(ringBenchOption).toInt(), EFFECT_BENCH_FRAMES);
+        return 0;
+    }
+    const int workerThreads{std::max(1, parser.value(threadsOption).toInt())};
+    if (parser.isSet(scalingBenchOption))
+    {
+        runScalingBenchmark(parser.value(scalingBenchOption).toInt(), EFFECT_BENCH_FRAMES, SCALING_BENCH_THREADS);
+        return 0;
+    }
+
+    const bool simulate{parser.isSet(simulateOption)};
+
+    const bool remote{parser.isSet(remoteOption) ||
+                      (!parser.isSet(localOption) && isForwardedDisplay())};
+    const UiProfile profile{remote ? remoteUiProfile() : localUiProfile()};
+    if (!profile.styleSheets)
+    {
+        QApplication::setEffectEnabled(Qt::UI_General, false); // No animated effects
+    }
+
     try
     {
-        setupGpio();
+        if (!simulate)
+        {
+            setupGpio();
+        }
+
+        PwmEngine engine;
+        engine.setHardwareOutput(!simulate);
+        engine.setWorkerThreads(static_cast<std::size_t>(workerThreads));
+
+        // Builds the immutable config the engine runs from: the file given
+        // with --config, or the built-in red/green/blue rig
+        const std::string configPath{parser.value(configOption).toStdString()};
+        const int simulatedChannels{parser.value(channelsOption).toInt()};
+        // A reload takes over the devices the running config already has open
+        const auto buildConfig{[&configPath, simulatedChannels, &engine]()
+                               {
+            RigConfig config{configPath.empty() ? defaultRigConfig() : loadRigConfig(configPath, &engine.config())};
+            addSimulatedChannels(config, simulatedChannels);
+            return std::make_shared<const RigConfig>(std::move(config)); }};
+        // The saved state goes in with the first config, so restored
+        // channels are written straight at their saved output
+        const std::string statePath{parser.value(stateOption).toStdString()};
+        std::unique_ptr<StateSnapshot> snapshot;
+        EngineState state;
+        if (!statePath.empty())
+        {
+            try
+            {
+                QDir{}.mkpath(QFileInfo{QString::fromStdString(statePath)}.absolutePath());
+                snapshot = std::make_unique<StateSnapshot>(statePath);
+                if (snapshot->load(state))
+                {
+                    engine.restoreState(state);
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                qWarning("Not saving state: %s", ex.what());
+            }
+        }
+        engine.applyConfig(buildConfig());
+        if (!state.channels.empty())
+        {
+            qInfo("Restored %zu saved channels from %s, outputs restored %lld ms after start",
+                  state.channels.size(), statePath.c_str(), startupTimer.elapsed());
+        }
+        if (parser.isSet(frameRingOption))
+        {
+            engine.setFrameRing(std::make_unique<FrameRing>(parser.value(frameRingOption).toStdString(),
+                                                            FRAME_RING_CHANNELS, FRAME_RING_SLOTS));
+        }
+
+        // Edits are parsed here and swapped in by the engine between frames;
+        // a broken file leaves the running configuration untouched. Saving a
+        // plugin the config uses reloads the config, and with it the plugin.
+        std::unique_ptr<ConfigWatcher> configWatcher;
+        std::vector<QPointer<ConfigWatcher>> pluginWatchers;
+        std::function<void(const RigConfig &)> watchPlugins;
+        const auto reload{[&engine, &buildConfig, &configPath, &watchPlugins]()
+                          {
+            try {
+                RigConfigPtr config{buildConfig()};
+                watchPlugins(*config);
+                engine.scheduleConfig(std::move(config));
+                qInfo("Reloaded %s", configPath.c_str());
+            } catch (const std::exception &ex) {
+                qWarning("Keeping previous configuration: %s", ex.what());
+            } }};
+        watchPlugins = [&app, &pluginWatchers, &reload](const RigConfig &config)
+        {
+            // The change signal of one of these may be what is running now
+            for (const QPointer<ConfigWatcher> &watcher : pluginWatchers)
+            {
+                if (watcher)
+                {
+                    watcher->deleteLater();
+                }
+            }
+            pluginWatchers.clear();
+
+            std::set<std::string> paths;
+            for (const ChannelConfig &channel : config.channels)
+            {
+                if (channel.plugin && paths.insert(channel.plugin->path()).second)
+                {
+                    auto *watcher{new ConfigWatcher{channel.plugin->path(), &app}};
+                    QObject::connect(watcher, &ConfigWatcher::changed, reload);
+                    pluginWatchers.emplace_back(watcher);
+                }
+            }
+        };
+        if (!configPath.empty())
+        {
+            configWatcher = std::make_unique<ConfigWatcher>(configPath);
+            QObject::connect(configWatcher.get(), &ConfigWatcher::changed, reload);
+            watchPlugins(engine.config());
+        }
+
+        // Strobes the channels for a fixed number of edges and reports how
+        // far each edge landed from its deadline
+        PreciseEffects effects{engine};
+        const int strobeEdges{parser.value(strobeProbeOption).toInt()};
+        if (strobeEdges > 0)
+        {
+            if (effectChannels(engine).empty())
+            {
+                qWarning("No GPIO or simulated channels to strobe");
+            }
+            effects.startStrobe(effectChannels(engine), PROBE_STROBE_TIME, PROBE_STROBE_TIME,
+                                static_cast<std::size_t>(strobeEdges));
+            effects.wait();
+            effects.reportEdgeErrors();
+            engine.allOff();
+            if (!simulate)
+            {
+                gpioTerminate();
+            }
+            return 0;
+        }
 
         // Ensure LEDs are safely turned off on application exit
-        QObject::connect(&app, &QCoreApplication::aboutToQuit, []()
+        // The state is saved once more first, so a restart comes back to the last frame;
+        // the outputs are still turned off, as pigpio stops software PWM when it terminates
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, [&engine, &effects, &snapshot, &state, simulate]()
+                         {
+            effects.stop();
+            if (snapshot) {
+                engine.captureState(state);
+                snapshot->save(state);
+            }
+            engine.allOff();
+            if (!simulate) {
+                gpioTerminate();
+            } });
+
+        QTimer stateTimer;
+        if (snapshot)
+        {
+            QObject::connect(&stateTimer, &QTimer::timeout, [&engine, &snapshot, &state]()
+                             {
+                engine.captureState(state);
+                snapshot->save(state); });
+            stateTimer.start(STATE_SAVE_INTERVAL_MS);
+        }
+
+        // Only logs while the config has an ambient loop, so a reload can add or remove one
+        QTimer ambientTimer;
+        QObject::connect(&ambientTimer, &QTimer::timeout, [&engine]()
                          {
-            gpioPWM(RED_LED, 0);
-            gpioPWM(GREEN_LED, 0);
-            gpioPWM(BLUE_LED, 0);
-            gpioTerminate(); });
+            if (const AmbientStats *stats{engine.ambientStats()}) {
+                qInfo("Ambient: %.0f lux (target %.0f), gain %.2f, %zu of %zu steps without a reading, "
+                      "step max %.0f us, late max %.1f ms, %zu settled (last in %.1f s)",
+                      stats->lux, engine.config().ambient.target, stats->gain, stats->missed, stats->steps,
+                      stats->maxStepUs, stats->maxLateMs, stats->settled, stats->lastSettleS);
+            } });
+        ambientTimer.start(AMBIENT_REPORT_INTERVAL_MS);
+
+        SceneStore scenes{MAX_SCENES};
+        auto window{createGui(engine, effects, scenes, profile)};
+        if (kiosk)
+        {
+            window->showFullScreen();
+        }
+        else
+        {
+            window->show();
+        }
+
+        // Reported once the first frame has been laid out and shown
+        QTimer::singleShot(0, [&startupTimer, &engine]()
+                           { qInfo("Startup: %lld ms, %zu channels, RSS %ld kB",
+                                   startupTimer.elapsed(), engine.channelCount(), residentMemoryKb()); });
+        if (profile.remote)
+        {
+            qInfo("Remote display detected: using low-bandwidth UI");
+        }
+
+        // Presses the first manual slider (red by default) repeatedly and
+        // reports how fast the pin follows
+        const int latencySamples{parser.value(latencyOption).toInt()};
+        std::unique_ptr<LatencyProbe> latencyProbe;
+        if (latencySamples > 0)
+        {
+            std::size_t probeChannel{0};
+            while (probeChannel < engine.channelCount() && !engine.channel(probeChannel).manual)
+            {
+                ++probeChannel;
+            }
+            if (probeChannel == engine.channelCount())
+            {
+                throw std::runtime_error{"--latency-probe needs a manual channel"};
+            }
 
-        auto window{createGui()};
-        window->show();
+            latencyProbe = std::make_unique<LatencyProbe>(*window->findChild<ChannelView *>(),
+                                                          engine, probeChannel, latencySamples);
+            latencyProbe->start();
+        }
 
         return app.exec();
     }
     catch (const std::exception &ex)
     {
         qCritical("Startup Error: %s", ex.what());
-        gpioTerminate();
+        if (!simulate)
+        {
+            gpioTerminate();
+        }
         return 1;
     }
-}
\ No newline at end of file
+}
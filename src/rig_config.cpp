@@ -0,0 +1,621 @@
+#include "rig_config.h"
+
+#include <QDir>          // Plugin paths relative to the configuration file
+#include <QFile>         // Reading the configuration file
+#include <QFileInfo>     // Directory of the configuration file
+#include <QJsonArray>    // "channels" list
+#include <QJsonDocument> // JSON parsing
+#include <QJsonObject>   // Per-channel settings
+#include <algorithm>     // Counting the LEDs of a strip
+#include <map>           // Compiled expressions by text
+#include <set>           // Duplicate pin, device name and expander output detection
+#include <stdexcept>     // For throwing runtime errors
+#include <utility>       // std::move, std::pair
+#include "pin_map.h"     // Built-in channel table and pin rules
+#include "effect_scripts.h" // Script names
+
+RigConfig defaultRigConfig()
+{
+    RigConfig config;
+    for (const ChannelDescriptor &descriptor : DEFAULT_CHANNELS)
+    {
+        ChannelConfig channel{descriptor.name, descriptor.gpioPin, descriptor.color, descriptor.pattern};
+        channel.inverted = descriptor.inverted;
+        channel.hardwarePwm = descriptor.hardwarePwm;
+        config.channels.push_back(std::move(channel));
+    }
+    return config;
+}
+
+/**
+ * Parses "#RRGGBB" into 0xRRGGBB.
+ */
+static std::uint32_t parseColor(const QString &text, const std::string &channel)
+{
+    bool ok{false};
+    const uint value{text.mid(1).toUInt(&ok, 16)};
+    if (!text.startsWith('#') || text.size() != 7 || !ok)
+    {
+        throw std::runtime_error{"Channel \"" + channel + "\": invalid color " + text.toStdString()};
+    }
+    return value;
+}
+
+static Pattern parsePattern(const QString &text, const std::string &channel)
+{
+    if (text == "manual")
+    {
+        return Pattern::Manual;
+    }
+    if (text == "fade")
+    {
+        return Pattern::Fade;
+    }
+    if (text == "flicker")
+    {
+        return Pattern::Flicker;
+    }
+    if (text == "fire")
+    {
+        return Pattern::Fire;
+    }
+    if (text == "twinkle")
+    {
+        return Pattern::Twinkle;
+    }
+    if (text == "script")
+    {
+        return Pattern::Script;
+    }
+    if (text == "expression")
+    {
+        return Pattern::Expression;
+    }
+    if (text == "plugin")
+    {
+        return Pattern::Plugin;
+    }
+    throw std::runtime_error{"Channel \"" + channel + "\": unknown pattern " + text.toStdString()};
+}
+
+static BlendMode parseBlendMode(const QString &text, const std::string &channel)
+{
+    if (text == "htp")
+    {
+        return BlendMode::Htp;
+    }
+    if (text == "multiply")
+    {
+        return BlendMode::Multiply;
+    }
+    if (text == "add")
+    {
+        return BlendMode::Add;
+    }
+    if (text == "replace")
+    {
+        return BlendMode::Replace;
+    }
+    throw std::runtime_error{"Channel \"" + channel + "\": unknown blend mode " + text.toStdString()};
+}
+
+static StripChip parseStripChip(const QString &text, const std::string &strip)
+{
+    if (text == "ws2812")
+    {
+        return StripChip::Ws2812;
+    }
+    if (text == "sk6812")
+    {
+        return StripChip::Sk6812;
+    }
+    if (text == "apa102")
+    {
+        return StripChip::Apa102;
+    }
+    if (text == "sk9822")
+    {
+        return StripChip::Sk9822;
+    }
+    throw std::runtime_error{"Strip \"" + strip + "\": unknown chip " + text.toStdString()};
+}
+
+static MergePolicy parseMergePolicy(const QString &text, const std::string &channel)
+{
+    if (text == "htp")
+    {
+        return MergePolicy::Htp;
+    }
+    if (text == "ltp")
+    {
+        return MergePolicy::Ltp;
+    }
+    throw std::runtime_error{"Channel \"" + channel + "\": unknown merge policy " + text.toStdString()};
+}
+
+/**
+ * Reads the optional "blend" object, e.g. { "effects": "multiply" }.
+ */
+static void parseBlend(const QJsonObject &blend, ChannelConfig &channel)
+{
+    static const char *const LAYER_NAMES[Compositor::LAYER_COUNT]{"base", "manual", "effects", "override"};
+    for (std::size_t layer{0}; layer < Compositor::LAYER_COUNT; ++layer)
+    {
+        if (blend.contains(LAYER_NAMES[layer]))
+        {
+            channel.blend[layer] = parseBlendMode(blend.value(LAYER_NAMES[layer]).toString(), channel.name);
+        }
+    }
+}
+
+// Compiled expressions and loaded plugins, shared by the channels of one file
+struct SharedResources
+{
+    QDir directory; // Plugin paths are relative to the configuration file
+    std::map<std::string, std::shared_ptr<const Expression>> expressions;
+    std::map<std::string, std::shared_ptr<const EffectPlugin>> plugins;
+    const RigConfig *running{nullptr}; // Config being replaced; its open devices are reused
+};
+
+/**
+ * The open device of a running config entry that matches, or nullptr. A
+ * reload takes it over instead of opening and setting up the device again.
+ */
+template <typename Entry, typename Matches>
+static auto findRunning(const std::vector<Entry> &entries, Matches &&matches) -> decltype(Entry::output)
+{
+    for (const Entry &entry : entries)
+    {
+        if (matches(*entry.output))
+        {
+            return entry.output;
+        }
+    }
+    return nullptr;
+}
+
+static ChannelConfig parseChannel(const QJsonObject &object, SharedResources &resources)
+{
+    ChannelConfig channel;
+    channel.name = object.value("name").toString().toStdString();
+    if (channel.name.empty())
+    {
+        throw std::runtime_error{"Every channel needs a name"};
+    }
+
+    channel.gpioPin = object.value("pin").toInt(NO_GPIO);
+    channel.color = parseColor(object.value("color").toString("#ffffff"), channel.name);
+    channel.pattern = parsePattern(object.value("pattern").toString("manual"), channel.name);
+    channel.range = object.value("range").toInt(255);
+    channel.frequency = object.value("frequency").toInt(0);
+    channel.step = object.value("step").toInt(2);
+    channel.inverted = object.value("inverted").toBool(false);
+    channel.hardwarePwm = object.value("hardware").toBool(false);
+    channel.script = object.value("script").toString().toStdString();
+    if (object.contains("expression"))
+    {
+        // Channels with the same formula share one compiled program
+        const std::string text{object.value("expression").toString().toStdString()};
+        std::shared_ptr<const Expression> &compiled{resources.expressions[text]};
+        if (!compiled)
+        {
+            try
+            {
+                compiled = std::make_shared<const Expression>(text);
+            }
+            catch (const std::runtime_error &error)
+            {
+                throw std::runtime_error{"Channel \"" + channel.name + "\": " + error.what()};
+            }
+        }
+        channel.expression = compiled;
+    }
+    if (object.contains("plugin"))
+    {
+        const std::string path{QDir::cleanPath(resources.directory.absoluteFilePath(object.value("plugin").toString()))
+                                   .toStdString()};
+        std::shared_ptr<const EffectPlugin> &plugin{resources.plugins[path]};
+        if (!plugin)
+        {
+            try
+            {
+                plugin = std::make_shared<const EffectPlugin>(path);
+            }
+            catch (const std::runtime_error &error)
+            {
+                throw std::runtime_error{"Channel \"" + channel.name + "\": " + error.what()};
+            }
+        }
+        channel.plugin = plugin;
+    }
+    channel.zone = object.value("zone").toString().toStdString();
+    channel.strip = object.value("strip").toString().toStdString();
+    channel.expander = object.value("expander").toString().toStdString();
+    channel.expanderOutput = object.value("output").toInt(0);
+    channel.controller = object.value("controller").toString().toStdString();
+    channel.base = object.value("base").toInt(0);
+    parseBlend(object.value("blend").toObject(), channel);
+    channel.merge = parseMergePolicy(object.value("merge").toString("ltp"), channel.name);
+    channel.slewMs = object.value("slewMs").toInt(0);
+    channel.smoothMs = object.value("smoothMs").toInt(0);
+
+    // pigpio accepts PWM ranges of 25–40000; pins follow the same rules as pin_map.h
+    if (channel.range < 25 || channel.range > 40000)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": range must be 25–40000"};
+    }
+    if (channel.gpioPin != NO_GPIO && !channel.strip.empty())
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": a strip LED cannot also have a GPIO pin"};
+    }
+    if (!channel.expander.empty() && (channel.gpioPin != NO_GPIO || !channel.strip.empty()))
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": an expander output cannot also have a pin or strip"};
+    }
+    if (!channel.controller.empty() && (channel.gpioPin != NO_GPIO || !channel.strip.empty() || !channel.expander.empty()))
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": an offloaded channel cannot also have a pin, strip or expander"};
+    }
+    if (channel.expanderOutput < 0 || channel.expanderOutput >= static_cast<int>(PCA9685_OUTPUTS))
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": output must be 0–15"};
+    }
+    if (channel.gpioPin != NO_GPIO && !isPwmCapablePin(channel.gpioPin))
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": GPIO pin cannot do PWM"};
+    }
+    if (channel.hardwarePwm && !isHardwarePwmPin(channel.gpioPin))
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": hardware PWM needs GPIO 12, 13, 18 or 19"};
+    }
+    if (channel.pattern == Pattern::Script && findEffectScript(channel.script) == nullptr)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": unknown script \"" + channel.script + "\""};
+    }
+    if (channel.pattern == Pattern::Plugin && !channel.plugin)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": the plugin pattern needs a \"plugin\""};
+    }
+    if (channel.pattern == Pattern::Expression && !channel.expression)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": the expression pattern needs an \"expression\""};
+    }
+    if (channel.base < 0 || channel.base > channel.range)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": base must be within the range"};
+    }
+    if (channel.frequency < 0 || channel.step <= 0)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": frequency and step must be positive"};
+    }
+    if (channel.slewMs < 0 || channel.smoothMs < 0)
+    {
+        throw std::runtime_error{"Channel \"" + channel.name + "\": slewMs and smoothMs cannot be negative"};
+    }
+    return channel;
+}
+
+/**
+ * Reads one entry of "strips" and opens its device, sized for the channels
+ * that name it, unless the running config has it open with the same
+ * settings. Device paths are relative to the configuration file.
+ */
+static StripConfig parseStrip(const QJsonObject &object, const std::vector<ChannelConfig> &channels,
+                              const SharedResources &resources)
+{
+    StripConfig strip{object.value("name").toString().toStdString(), nullptr};
+    if (strip.name.empty())
+    {
+        throw std::runtime_error{"Every strip needs a name"};
+    }
+    const StripChip chip{parseStripChip(object.value("chip").toString("ws2812"), strip.name)};
+    const int speed{object.value("speed").toInt(isClockedChip(chip) ? APA102_SPI_HZ : WS281X_SPI_HZ)};
+    if (speed <= 0)
+    {
+        throw std::runtime_error{"Strip \"" + strip.name + "\": speed must be positive"};
+    }
+    if (object.value("device").toString().isEmpty())
+    {
+        throw std::runtime_error{"Strip \"" + strip.name + "\": needs a \"device\""};
+    }
+
+    const auto leds{static_cast<std::size_t>(std::count_if(channels.begin(), channels.end(),
+                                                           [&strip](const ChannelConfig &channel)
+                                                           { return channel.strip == strip.name; }))};
+    const std::string device{QDir::cleanPath(resources.directory.absoluteFilePath(object.value("device").toString()))
+                                 .toStdString()};
+    if (resources.running != nullptr)
+    {
+        strip.output = findRunning(resources.running->strips, [&](const LedStrip &open)
+                                   { return open.device() == device && open.chip() == chip &&
+                                            open.ledCount() == leds && open.speedHz() == speed; });
+        if (strip.output)
+        {
+            return strip;
+        }
+    }
+    try
+    {
+        strip.output = std::make_shared<LedStrip>(device, chip, leds, speed);
+    }
+    catch (const std::runtime_error &error)
+    {
+        throw std::runtime_error{"Strip \"" + strip.name + "\": " + error.what()};
+    }
+    return strip;
+}
+
+/**
+ * Reads one entry of "expanders" and sets up the chip, unless the running
+ * config already drives it at the same frequency.
+ */
+static ExpanderConfig parseExpander(const QJsonObject &object, const SharedResources &resources)
+{
+    ExpanderConfig expander{object.value("name").toString().toStdString(), nullptr};
+    if (expander.name.empty())
+    {
+        throw std::runtime_error{"Every expander needs a name"};
+    }
+    const std::string device{object.value("device").toString("/dev/i2c-1").toStdString()};
+    const int address{object.value("address").toInt(PCA9685_DEFAULT_ADDRESS)};
+    const int frequency{object.value("frequency").toInt(1000)};
+    if (address < 0 || address > 0x7F)
+    {
+        throw std::runtime_error{"Expander \"" + expander.name + "\": address must be 0–127"};
+    }
+    if (frequency < PCA9685_MIN_HZ || frequency > PCA9685_MAX_HZ)
+    {
+        throw std::runtime_error{"Expander \"" + expander.name + "\": frequency must be 24–1526 Hz"};
+    }
+    if (resources.running != nullptr)
+    {
+        expander.output = findRunning(resources.running->expanders, [&](const Pca9685 &open)
+                                      { return open.device() == device && open.address() == address &&
+                                               open.frequency() == frequency; });
+        if (expander.output)
+        {
+            return expander;
+        }
+    }
+
+    try
+    {
+        expander.output = std::make_shared<Pca9685>(device, address, frequency);
+    }
+    catch (const std::runtime_error &error)
+    {
+        throw std::runtime_error{"Expander \"" + expander.name + "\": " + error.what()};
+    }
+    return expander;
+}
+
+/**
+ * Reads one entry of "controllers" and opens its serial port, sized for
+ * the channels that name it, unless the running config already has that
+ * link open at the same baud rate and size.
+ */
+static ControllerConfig parseController(const QJsonObject &object, const std::vector<ChannelConfig> &channels,
+                                        const SharedResources &resources)
+{
+    ControllerConfig controller{object.value("name").toString().toStdString(), nullptr};
+    if (controller.name.empty())
+    {
+        throw std::runtime_error{"Every controller needs a name"};
+    }
+    const std::string device{object.value("device").toString("/dev/serial0").toStdString()};
+    const int baud{object.value("baud").toInt(921600)};
+    const auto count{static_cast<std::size_t>(std::count_if(channels.begin(), channels.end(),
+                                                            [&controller](const ChannelConfig &channel)
+                                                            { return channel.controller == controller.name; }))};
+    if (resources.running != nullptr)
+    {
+        // Taking over the link also keeps the receiver's levels, so no keyframe is needed
+        controller.output = findRunning(resources.running->controllers, [&](const OffloadLink &open)
+                                        { return open.device() == device && open.baud() == baud &&
+                                                 open.channelCount() == count; });
+        if (controller.output)
+        {
+            return controller;
+        }
+    }
+    try
+    {
+        controller.output = std::make_shared<OffloadLink>(device, baud, count);
+    }
+    catch (const std::runtime_error &error)
+    {
+        throw std::runtime_error{"Controller \"" + controller.name + "\": " + error.what()};
+    }
+    return controller;
+}
+
+/**
+ * Reads "ambient" and opens its sensor, unless the running config already
+ * samples the same file at the same interval.
+ */
+static AmbientConfig parseAmbient(const QJsonObject &object, const std::vector<ChannelConfig> &channels,
+                                  const SharedResources &resources)
+{
+    AmbientConfig ambient;
+    ambient.target = object.value("target").toDouble(ambient.target);
+    ambient.zone = object.value("zone").toString().toStdString();
+    ambient.intervalMs = object.value("intervalMs").toInt(ambient.intervalMs);
+    ambient.kp = object.value("kp").toDouble(ambient.kp);
+    ambient.ki = object.value("ki").toDouble(ambient.ki);
+    ambient.kd = object.value("kd").toDouble(ambient.kd);
+    ambient.minGain = object.value("minGain").toDouble(ambient.minGain);
+    if (ambient.target <= 0.0)
+    {
+        throw std::runtime_error{"Ambient loop: target must be positive"};
+    }
+    if (ambient.intervalMs <= 0)
+    {
+        throw std::runtime_error{"Ambient loop: intervalMs must be positive"};
+    }
+    if (ambient.minGain < 0.0 || ambient.minGain > 1.0)
+    {
+        throw std::runtime_error{"Ambient loop: minGain must be 0–1"};
+    }
+    const bool knownZone{std::any_of(channels.begin(), channels.end(), [&ambient](const ChannelConfig &channel)
+                                     { return channel.zone == ambient.zone; })};
+    if (!ambient.zone.empty() && !knownZone)
+    {
+        throw std::runtime_error{"Ambient loop: unknown zone \"" + ambient.zone + "\""};
+    }
+
+    const std::string sensor{object.value("sensor").toString().toStdString()};
+    if (sensor.empty())
+    {
+        throw std::runtime_error{"Ambient loop: needs a \"sensor\""};
+    }
+    if (sensor == "simulated")
+    {
+        const QJsonObject simulation{object.value("simulation").toObject()};
+        SimulatedRoom room;
+        room.ambient = simulation.value("ambient").toDouble(room.ambient);
+        room.swing = simulation.value("swing").toDouble(room.swing);
+        room.period = simulation.value("period").toDouble(room.period);
+        room.led = simulation.value("led").toDouble(room.led);
+        room.lag = simulation.value("lag").toDouble(room.lag);
+        room.noise = simulation.value("noise").toDouble(room.noise);
+        if (room.period <= 0.0)
+        {
+            throw std::runtime_error{"Ambient loop: simulation period must be positive"};
+        }
+        ambient.sensor = std::make_shared<SimulatedLightSensor>(room);
+        return ambient;
+    }
+    if (resources.running != nullptr)
+    {
+        const auto open{std::dynamic_pointer_cast<IioLightSensor>(resources.running->ambient.sensor)};
+        if (open && open->path() == sensor && open->period().count() == ambient.intervalMs)
+        {
+            ambient.sensor = open;
+            return ambient;
+        }
+    }
+    try
+    {
+        ambient.sensor = std::make_shared<IioLightSensor>(sensor, std::chrono::milliseconds{ambient.intervalMs});
+    }
+    catch (const std::runtime_error &error)
+    {
+        throw std::runtime_error{std::string{"Ambient loop: "} + error.what()};
+    }
+    return ambient;
+}
+
+RigConfig loadRigConfig(const std::string &path, const RigConfig *running)
+{
+    QFile file{QString::fromStdString(path)};
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw std::runtime_error{"Cannot open " + path};
+    }
+
+    QJsonParseError error{};
+    const QJsonDocument document{QJsonDocument::fromJson(file.readAll(), &error)};
+    if (error.error != QJsonParseError::NoError || !document.isObject())
+    {
+        throw std::runtime_error{path + ": " + error.errorString().toStdString()};
+    }
+
+    const QJsonObject root{document.object()};
+    RigConfig config;
+    config.frameIntervalMs = root.value("frameIntervalMs").toInt(20);
+    if (config.frameIntervalMs <= 0)
+    {
+        throw std::runtime_error{path + ": frameIntervalMs must be positive"};
+    }
+    config.seed = static_cast<std::uint32_t>(root.value("seed").toDouble(1));
+
+    std::set<int> usedPins;
+    std::set<int> usedHardwarePwm;
+    SharedResources resources;
+    resources.directory = QFileInfo{file}.absoluteDir();
+    resources.running = running;
+    for (const QJsonValue &value : root.value("channels").toArray())
+    {
+        ChannelConfig channel{parseChannel(value.toObject(), resources)};
+        if (channel.gpioPin != NO_GPIO && !usedPins.insert(channel.gpioPin).second)
+        {
+            throw std::runtime_error{"Channel \"" + channel.name + "\": GPIO pin already in use"};
+        }
+        if (channel.hardwarePwm && !usedHardwarePwm.insert(hardwarePwmChannel(channel.gpioPin)).second)
+        {
+            throw std::runtime_error{"Channel \"" + channel.name + "\": its hardware PWM channel is already in use"};
+        }
+        config.channels.push_back(std::move(channel));
+    }
+
+    // Channels name their device, so each name may only stand for one; checked before it is opened
+    const auto checkUnique{[](std::set<std::string> &names, const QJsonValue &value, const char *kind)
+                           {
+                               const std::string name{value.toObject().value("name").toString().toStdString()};
+                               if (!name.empty() && !names.insert(name).second)
+                               {
+                                   throw std::runtime_error{std::string{kind} + " \"" + name + "\": name already in use"};
+                               }
+                           }};
+    std::set<std::string> stripNames;
+    for (const QJsonValue &value : root.value("strips").toArray())
+    {
+        checkUnique(stripNames, value, "Strip");
+        config.strips.push_back(parseStrip(value.toObject(), config.channels, resources));
+    }
+    std::set<std::string> expanderNames;
+    for (const QJsonValue &value : root.value("expanders").toArray())
+    {
+        checkUnique(expanderNames, value, "Expander");
+        config.expanders.push_back(parseExpander(value.toObject(), resources));
+    }
+
+    std::set<std::string> controllerNames;
+    for (const QJsonValue &value : root.value("controllers").toArray())
+    {
+        checkUnique(controllerNames, value, "Controller");
+        config.controllers.push_back(parseController(value.toObject(), config.channels, resources));
+    }
+    if (root.value("ambient").isObject())
+    {
+        config.ambient = parseAmbient(root.value("ambient").toObject(), config.channels, resources);
+    }
+
+    std::set<std::pair<std::string, int>> usedOutputs;
+    for (const ChannelConfig &channel : config.channels)
+    {
+        const bool known{std::any_of(config.strips.begin(), config.strips.end(), [&channel](const StripConfig &strip)
+                                     { return strip.name == channel.strip; })};
+        if (!channel.strip.empty() && !known)
+        {
+            throw std::runtime_error{"Channel \"" + channel.name + "\": unknown strip \"" + channel.strip + "\""};
+        }
+        const bool knownExpander{std::any_of(config.expanders.begin(), config.expanders.end(),
+                                             [&channel](const ExpanderConfig &expander)
+                                             { return expander.name == channel.expander; })};
+        if (!channel.expander.empty() && !knownExpander)
+        {
+            throw std::runtime_error{"Channel \"" + channel.name + "\": unknown expander \"" + channel.expander + "\""};
+        }
+        if (!channel.expander.empty() && !usedOutputs.insert({channel.expander, channel.expanderOutput}).second)
+        {
+            throw std::runtime_error{"Channel \"" + channel.name + "\": expander output already in use"};
+        }
+        const bool knownController{std::any_of(config.controllers.begin(), config.controllers.end(),
+                                               [&channel](const ControllerConfig &controller)
+                                               { return controller.name == channel.controller; })};
+        if (!channel.controller.empty() && !knownController)
+        {
+            throw std::runtime_error{"Channel \"" + channel.name + "\": unknown controller \"" + channel.controller + "\""};
+        }
+    }
+    return config;
+}
+
+void addSimulatedChannels(RigConfig &config, int count)
+{
+    for (int i{1}; i <= count; ++i)
+    {
+        config.channels.push_back(ChannelConfig{"Channel " + std::to_string(i)});
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>   // Per-layer blend modes
+#include <cstdint> // std::uint32_t colors
+#include <memory>  // std::shared_ptr to the immutable config
+#include <string>  // Channel names and file paths
+#include <vector>  // Channel list
+#include "ambient_control.h"
+#include "compositor.h"
+#include "effect_plugin.h"
+#include "expression.h"
+#include "led_strip.h"
+#include "offload_link.h"
+#include "pca9685.h"
+#include "source_merger.h"
+
+// Pin value used for channels that are not wired to a GPIO pin (simulated)
+constexpr int NO_GPIO{-1};
+
+// How a channel's duty is produced
+enum class Pattern
+{
+    Manual,     // Set from the GUI slider
+    Fade,       // Bounces between 0 and range (the original green/blue see-saw)
+    Flicker,    // Candle flame (see procedural.h)
+    Fire,
+    Twinkle,
+    Script,     // A coroutine effect script (see effect_scripts.h)
+    Expression, // A brightness formula (see expression.h)
+    Plugin      // An effect plugin loaded at runtime (see effect_plugin_api.h)
+};
+
+/**
+ * Description of one output channel as read from the configuration file.
+ */
+struct ChannelConfig
+{
+    std::string name;
+    int gpioPin{NO_GPIO};
+    std::uint32_t color{0xFFFFFF}; // LED color as 0xRRGGBB
+    Pattern pattern{Pattern::Manual};
+    int range{255};                // Maximum duty value (pigpio PWM range)
+    int frequency{0};              // PWM frequency in Hz, 0 = pigpio default
+    int step{2};                   // Fade: duty change per frame; procedural patterns: speed
+    bool inverted{false};          // Fade: output range - value (see-saw partner)
+    bool hardwarePwm{false};       // Drive the pin from the PWM peripheral
+    std::string script;            // Script: name of the effect script
+    std::shared_ptr<const Expression> expression; // Expression: compiled once, shared by equal formulas
+    std::shared_ptr<const EffectPlugin> plugin;   // Plugin: loaded once per file, shared by its channels
+    std::string zone;              // Zone submaster the channel belongs to, if any
+    std::string strip;             // Addressable strip the channel is an LED of, if any
+    std::string expander;          // PCA9685 the channel is an output of, if any
+    int expanderOutput{0};         // Output on the expander (0–15)
+    std::string controller;        // Microcontroller the channel is offloaded to, if any
+    int base{0};                   // Resting level on the base layer, 0 = none
+    std::array<BlendMode, Compositor::LAYER_COUNT> blend{DEFAULT_BLEND};
+    MergePolicy merge{MergePolicy::Ltp}; // How equal-priority sources combine
+    int slewMs{0};                 // Output: time for a move across the whole range, 0 = instant
+    int smoothMs{0};               // Output: time constant of exponential smoothing, 0 = none
+};
+
+/**
+ * An addressable LED strip. Its LEDs are the channels naming it, in the
+ * order they appear in the file; the device is opened when the file is
+ * loaded, so a bad path is reported like any other config error.
+ */
+struct StripConfig
+{
+    std::string name;
+    std::shared_ptr<LedStrip> output;
+};
+
+/**
+ * A PCA9685 PWM expander, opened and set up when the file is loaded.
+ */
+struct ExpanderConfig
+{
+    std::string name;
+    std::shared_ptr<Pca9685> output;
+};
+
+/**
+ * A microcontroller on a serial port that drives outputs on its own.
+ * Its channels are the ones naming it, in the order of the file.
+ */
+struct ControllerConfig
+{
+    std::string name;
+    std::shared_ptr<OffloadLink> output;
+};
+
+/**
+ * A complete rig description. Once built it is never modified; a reload
+ * builds a new one and the engine swaps to it between two frames.
+ */
+struct RigConfig
+{
+    int frameIntervalMs{20}; // Engine frame period
+    std::uint32_t seed{1};   // Seed of the procedural patterns, for repeatable runs
+    std::vector<ChannelConfig> channels;
+    std::vector<StripConfig> strips;
+    std::vector<ExpanderConfig> expanders;
+    std::vector<ControllerConfig> controllers;
+    AmbientConfig ambient;
+};
+
+using RigConfigPtr = std::shared_ptr<const RigConfig>;
+
+// The built-in rig from DEFAULT_CHANNELS (see pin_map.h)
+RigConfig defaultRigConfig();
+
+// Parses a JSON configuration file; throws std::runtime_error if it is invalid.
+// Devices that running (the config being replaced, if any) has open with the
+// same settings are shared with it rather than opened again.
+RigConfig loadRigConfig(const std::string &path, const RigConfig *running = nullptr);
+
+// Appends count manual channels without a GPIO pin, for scale testing
+void addSimulatedChannels(RigConfig &config, int count);
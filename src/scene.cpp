@@ -0,0 +1,41 @@
+#include "scene.h"
+
+#include <stdexcept> // For throwing runtime errors
+
+SceneStore::SceneStore(std::size_t capacity)
+    : m_scenes(capacity)
+{
+}
+
+std::size_t SceneStore::indexOf(const std::string &name) const
+{
+    std::size_t i{0};
+    while (i < m_used && m_scenes[i].name != name)
+    {
+        ++i;
+    }
+    return i;
+}
+
+const Scene *SceneStore::find(const std::string &name) const
+{
+    const std::size_t index{indexOf(name)};
+    return index < m_used ? &m_scenes[index] : nullptr;
+}
+
+Scene &SceneStore::slot(const std::string &name)
+{
+    const std::size_t index{indexOf(name)};
+    if (index < m_used)
+    {
+        return m_scenes[index];
+    }
+    if (m_used == m_scenes.size())
+    {
+        throw std::runtime_error{"Scene store is full"};
+    }
+
+    Scene &scene{m_scenes[m_used++]};
+    scene.name = name;
+    return scene;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <string>  // Scene names
+#include <vector>  // Scene storage
+#include "rig_config.h"
+
+/**
+ * Everything needed to bring one channel back to a stored look: its duty
+ * and, for patterns, where the pattern was and how it runs.
+ */
+struct SceneChannel
+{
+    int duty{0};
+    Pattern pattern{Pattern::Manual};
+    int step{2};
+    bool inverted{false};
+    int brightness{0};
+    bool increasing{true};
+};
+
+struct Scene
+{
+    std::string name;
+    std::vector<SceneChannel> channels; // One entry per engine channel
+};
+
+/**
+ * Fixed-capacity cache of named scenes. All slots are allocated up front;
+ * storing over an existing scene reuses its buffers, so capturing and
+ * recalling scenes does not allocate once the cache has warmed up.
+ */
+class SceneStore
+{
+public:
+    explicit SceneStore(std::size_t capacity);
+
+    // The scene with this name, or nullptr
+    const Scene *find(const std::string &name) const;
+
+    // The slot to capture into: the existing scene of that name or a free
+    // slot. Throws std::runtime_error if the store is full.
+    Scene &slot(const std::string &name);
+
+    std::size_t size() const { return m_used; }
+    const Scene &at(std::size_t index) const { return m_scenes[index]; }
+
+private:
+    // Index of the scene with this name, or m_used if there is none
+    std::size_t indexOf(const std::string &name) const;
+
+    std::vector<Scene> m_scenes;
+    std::size_t m_used{0};
+};
@@ -0,0 +1,90 @@
+#include "source_merger.h"
+
+#include <utility> // std::move
+
+SourceMerger::SourceId SourceMerger::addSource(std::string name, int priority)
+{
+    const std::size_t channels{m_merged.size()};
+    Source source;
+    source.name = std::move(name);
+    source.priority = priority;
+    source.value.assign(channels, 0);
+    source.stamp.assign(channels, 0);
+    source.present.assign(channels, 0);
+    source.changed.assign(m_pending.size(), 0);
+    m_sources.push_back(std::move(source));
+    return m_sources.size() - 1;
+}
+
+void SourceMerger::reset(std::size_t channels)
+{
+    const std::size_t words{(channels + 63) / 64};
+    for (Source &source : m_sources)
+    {
+        source.value.assign(channels, 0);
+        source.stamp.assign(channels, 0);
+        source.present.assign(channels, 0);
+        source.changed.assign(words, 0);
+        source.anyChanged = false;
+    }
+    m_policy.assign(channels, MergePolicy::Ltp);
+    m_merged.assign(channels, 0);
+    m_pending.assign(words, 0);
+}
+
+void SourceMerger::setValue(SourceId id, std::size_t channel, int value)
+{
+    Source &source{m_sources[id]};
+    source.value[channel] = value;
+    source.stamp[channel] = ++m_clock;
+    source.present[channel] = 1;
+    markChanged(source, channel);
+}
+
+void SourceMerger::release(SourceId id, std::size_t channel)
+{
+    Source &source{m_sources[id]};
+    if (source.present[channel] != 0)
+    {
+        source.present[channel] = 0;
+        markChanged(source, channel);
+    }
+}
+
+void SourceMerger::markChanged(Source &source, std::size_t channel)
+{
+    source.changed[channel / 64] |= std::uint64_t{1} << (channel % 64);
+    source.anyChanged = true;
+}
+
+/**
+ * Highest priority wins; equal priorities are resolved by the channel's
+ * policy. A channel no source holds merges to 0.
+ */
+int SourceMerger::mergeChannel(std::size_t channel) const
+{
+    const Source *best{nullptr};
+    for (const Source &source : m_sources)
+    {
+        if (source.present[channel] == 0)
+        {
+            continue;
+        }
+        if (best == nullptr || source.priority > best->priority)
+        {
+            best = &source;
+            continue;
+        }
+        if (source.priority == best->priority)
+        {
+            const bool wins{m_policy[channel] == MergePolicy::Htp
+                                ? source.value[channel] > best->value[channel]
+                                : source.stamp[channel] > best->stamp[channel]};
+            if (wins)
+            {
+                best = &source;
+            }
+        }
+    }
+    return best != nullptr ? best->value[channel] : 0;
+}
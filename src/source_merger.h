@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // Change mask words and write stamps
+#include <string>  // Source names
+#include <vector>  // Per-source buffers
+
+// How sources of equal priority are combined on a channel
+enum class MergePolicy : std::uint8_t
+{
+    Htp, // Highest value wins
+    Ltp  // Most recently written value wins
+};
+
+/**
+ * Merges the values that several sources (GUI sliders, scene playback,
+ * external controllers) write for the same channels.
+ *
+ * Each source writes into its own buffer and sets a bit in its change
+ * mask. merge() runs once per frame: it ORs together the masks of the
+ * sources that changed anything, then re-merges only the marked channels.
+ * A source that wrote nothing during a frame costs nothing.
+ *
+ * For each channel the highest-priority source holding a value wins; ties
+ * between sources of equal priority follow the channel's merge policy.
+ */
+class SourceMerger
+{
+public:
+    using SourceId = std::size_t;
+
+    SourceId addSource(std::string name, int priority);
+
+    // Clears all buffers for a new channel count; sources stay registered
+    void reset(std::size_t channels);
+
+    void setPolicy(std::size_t channel, MergePolicy policy) { m_policy[channel] = policy; }
+    void setValue(SourceId source, std::size_t channel, int value);
+
+    // The source stops controlling the channel
+    void release(SourceId source, std::size_t channel);
+
+    // Re-merges the changed channels, calling changed(channel, value) for
+    // every channel whose merged value differs from the previous frame
+    template <typename Callback>
+    void merge(Callback &&changed);
+
+    int merged(std::size_t channel) const { return m_merged[channel]; }
+
+private:
+    struct Source
+    {
+        std::string name;
+        int priority;
+        std::vector<int> value;
+        std::vector<std::uint64_t> stamp;   // Write order, for LTP
+        std::vector<std::uint8_t> present;  // 1 where the source holds a value
+        std::vector<std::uint64_t> changed; // One bit per channel
+        bool anyChanged{false};
+    };
+
+    void markChanged(Source &source, std::size_t channel);
+    int mergeChannel(std::size_t channel) const;
+
+    std::vector<Source> m_sources;
+    std::vector<MergePolicy> m_policy;
+    std::vector<int> m_merged;
+    std::vector<std::uint64_t> m_pending; // Union of the change masks
+    std::uint64_t m_clock{0};
+};
+
+template <typename Callback>
+void SourceMerger::merge(Callback &&changed)
+{
+    bool any{false};
+    for (Source &source : m_sources)
+    {
+        if (!source.anyChanged)
+        {
+            continue;
+        }
+        for (std::size_t w{0}; w < m_pending.size(); ++w)
+        {
+            m_pending[w] |= source.changed[w];
+            source.changed[w] = 0;
+        }
+        source.anyChanged = false;
+        any = true;
+    }
+    if (!any)
+    {
+        return;
+    }
+
+    for (std::size_t w{0}; w < m_pending.size(); ++w)
+    {
+        for (std::uint64_t bits{m_pending[w]}; bits != 0; bits &= bits - 1)
+        {
+            const std::size_t channel{w * 64 + static_cast<std::size_t>(__builtin_ctzll(bits))};
+            const int value{mergeChannel(channel)};
+            if (value != m_merged[channel])
+            {
+                m_merged[channel] = value;
+                changed(channel, value);
+            }
+        }
+        m_pending[w] = 0;
+    }
+}
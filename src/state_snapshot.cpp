@@ -0,0 +1,198 @@
+#include "state_snapshot.h"
+
+#include <algorithm>  // std::min
+#include <fcntl.h>    // open
+#include <stdexcept>  // std::runtime_error
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // ftruncate, close
+
+constexpr std::uint32_t SNAPSHOT_MAGIC{0x534D5750}; // "PWMS"
+constexpr std::uint32_t SNAPSHOT_VERSION{2};
+// The copies start after the header, on a cache line
+constexpr std::size_t HEADER_BYTES{64};
+
+namespace
+{
+struct FileHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t maxChannels;
+    std::uint32_t maxGroups;
+};
+
+struct FileChannel
+{
+    std::int32_t gpioPin;
+    std::uint32_t nameHash;
+    std::int32_t range;
+    std::int32_t duty;
+    std::int32_t output;
+    std::int32_t effect;
+    std::int32_t step;
+    std::int32_t brightness;
+    std::uint8_t pattern;
+    std::uint8_t inverted;
+    std::uint8_t increasing;
+    std::uint8_t reserved;
+};
+
+struct FileGroup
+{
+    std::uint32_t nameHash;
+    std::int32_t level;
+};
+} // namespace
+
+struct StateSnapshot::Copy
+{
+    std::uint64_t sequence; // Copy n of the file's life is at index n % 2; written last
+    double time;
+    std::uint32_t channelCount;
+    std::uint32_t groupCount;
+    std::uint32_t checksum; // Over the sequence, time, gain, counts and used entries
+    float ambientGain;
+    FileChannel channels[MAX_CHANNELS];
+    FileGroup groups[MAX_GROUPS];
+};
+
+std::uint32_t stateNameHash(const std::string &name)
+{
+    std::uint32_t hash{2166136261u};
+    for (const char c : name)
+    {
+        hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+static std::uint32_t hashBytes(std::uint32_t hash, const void *data, std::size_t length)
+{
+    const auto *bytes{static_cast<const std::uint8_t *>(data)};
+    for (std::size_t i{0}; i < length; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+StateSnapshot::StateSnapshot(const std::string &path)
+    : m_path{path}, m_bytes{HEADER_BYTES + 2 * sizeof(Copy)}
+{
+    const int fd{open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+    struct stat info{};
+    if (fd < 0 || fstat(fd, &info) < 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error{"Cannot open state file " + path};
+    }
+    // A file of another size is from another version; it is started over
+    const bool fresh{static_cast<std::size_t>(info.st_size) != m_bytes};
+    void *memory{!fresh || (ftruncate(fd, 0) == 0 && ftruncate(fd, static_cast<off_t>(m_bytes)) == 0)
+                     ? mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                     : MAP_FAILED};
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        throw std::runtime_error{"Cannot map state file " + path};
+    }
+    m_memory = static_cast<std::uint8_t *>(memory);
+
+    auto *header{reinterpret_cast<FileHeader *>(m_memory)};
+    if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+        header->maxChannels != MAX_CHANNELS || header->maxGroups != MAX_GROUPS)
+    {
+        copy(0)->sequence = 0;
+        copy(0)->checksum = 0;
+        copy(1)->sequence = 0;
+        copy(1)->checksum = 0;
+        *header = FileHeader{SNAPSHOT_MAGIC, SNAPSHOT_VERSION, MAX_CHANNELS, MAX_GROUPS};
+    }
+
+    for (std::size_t index{0}; index < 2; ++index)
+    {
+        const Copy &saved{*copy(index)};
+        if (saved.sequence % 2 == index && saved.checksum == checksum(saved, saved.sequence))
+        {
+            m_sequence = std::max(m_sequence, saved.sequence);
+        }
+    }
+}
+
+StateSnapshot::~StateSnapshot()
+{
+    munmap(m_memory, m_bytes);
+}
+
+StateSnapshot::Copy *StateSnapshot::copy(std::size_t index) const
+{
+    return reinterpret_cast<Copy *>(m_memory + HEADER_BYTES + index * sizeof(Copy));
+}
+
+std::uint32_t StateSnapshot::checksum(const Copy &copy, std::uint64_t sequence)
+{
+    std::uint32_t hash{hashBytes(2166136261u, &sequence, sizeof(sequence))};
+    hash = hashBytes(hash, &copy.time, sizeof(copy.time));
+    hash = hashBytes(hash, &copy.ambientGain, sizeof(copy.ambientGain));
+    hash = hashBytes(hash, &copy.channelCount, sizeof(copy.channelCount));
+    hash = hashBytes(hash, &copy.groupCount, sizeof(copy.groupCount));
+    hash = hashBytes(hash, copy.channels, std::min<std::size_t>(copy.channelCount, MAX_CHANNELS) * sizeof(FileChannel));
+    return hashBytes(hash, copy.groups, std::min<std::size_t>(copy.groupCount, MAX_GROUPS) * sizeof(FileGroup));
+}
+
+bool StateSnapshot::load(EngineState &state) const
+{
+    if (m_sequence == 0)
+    {
+        return false;
+    }
+    const Copy &saved{*copy(m_sequence % 2)};
+    state.time = saved.time;
+    state.ambientGain = saved.ambientGain;
+    state.channels.resize(std::min<std::size_t>(saved.channelCount, MAX_CHANNELS));
+    for (std::size_t i{0}; i < state.channels.size(); ++i)
+    {
+        const FileChannel &channel{saved.channels[i]};
+        state.channels[i] = SavedChannel{channel.gpioPin, channel.nameHash, channel.range, channel.duty,
+                                         channel.output, channel.effect, static_cast<Pattern>(channel.pattern),
+                                         channel.step, channel.inverted != 0, channel.brightness,
+                                         channel.increasing != 0};
+    }
+    state.groups.resize(std::min<std::size_t>(saved.groupCount, MAX_GROUPS));
+    for (std::size_t i{0}; i < state.groups.size(); ++i)
+    {
+        state.groups[i] = SavedGroup{saved.groups[i].nameHash, saved.groups[i].level};
+    }
+    return true;
+}
+
+void StateSnapshot::save(const EngineState &state)
+{
+    const std::uint64_t sequence{m_sequence + 1};
+    Copy &target{*copy(sequence % 2)};
+    target.time = state.time;
+    target.ambientGain = static_cast<float>(state.ambientGain);
+    target.channelCount = static_cast<std::uint32_t>(std::min(state.channels.size(), MAX_CHANNELS));
+    target.groupCount = static_cast<std::uint32_t>(std::min(state.groups.size(), MAX_GROUPS));
+    for (std::size_t i{0}; i < target.channelCount; ++i)
+    {
+        const SavedChannel &channel{state.channels[i]};
+        target.channels[i] = FileChannel{channel.gpioPin, channel.nameHash, channel.range, channel.duty,
+                                         channel.output, channel.effect, channel.step, channel.brightness,
+                                         static_cast<std::uint8_t>(channel.pattern), channel.inverted,
+                                         channel.increasing, 0};
+    }
+    for (std::size_t i{0}; i < target.groupCount; ++i)
+    {
+        target.groups[i] = FileGroup{state.groups[i].nameHash, state.groups[i].level};
+    }
+
+    // Complete and checksummed before its sequence makes it the newest
+    target.checksum = checksum(target, sequence);
+    __atomic_store_n(&target.sequence, sequence, __ATOMIC_RELEASE);
+    m_sequence = sequence;
+}
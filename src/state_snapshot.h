@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // File layout
+#include <string>  // File path
+#include <vector>  // Saved channels and groups
+#include "rig_config.h"
+
+/**
+ * A channel as it was when the state was saved. Matched to the channels
+ * of the next config like a reload does: by pin, or by name for channels
+ * without one.
+ */
+struct SavedChannel
+{
+    int gpioPin{NO_GPIO};
+    std::uint32_t nameHash{0};
+    int range{255};
+    int duty{0};
+    int output{0};
+    int effect{-1}; // Pattern value on the effects layer, -1 = none
+    Pattern pattern{Pattern::Manual};
+    int step{2};
+    bool inverted{false};
+    int brightness{0};
+    bool increasing{true};
+};
+
+struct SavedGroup
+{
+    std::uint32_t nameHash{0};
+    int level{255};
+};
+
+// What a restarted engine needs to carry on where the previous one stopped
+struct EngineState
+{
+    std::vector<SavedChannel> channels;
+    std::vector<SavedGroup> groups;
+    double time{0.0};        // Engine seconds, the t of expressions and plugins
+    double ambientGain{1.0}; // Of the ambient light loop, if the rig has one
+};
+
+// Hash that saved channels and groups are matched by (FNV-1a)
+std::uint32_t stateNameHash(const std::string &name);
+
+/**
+ * Keeps the engine state in a small memory-mapped file, so a restarted
+ * process can pick up the outputs where the previous one left them
+ * instead of starting from 0.
+ *
+ * The file holds two copies. save() writes the older one and marks it
+ * newest only after its checksum, so a process killed while saving still
+ * leaves the other copy intact. Stores land in the page cache, which
+ * outlives the process; the kernel writes them back in its own time.
+ *
+ * Up to MAX_CHANNELS channels and MAX_GROUPS groups are saved; channels
+ * beyond that start from 0.
+ */
+class StateSnapshot
+{
+public:
+    static constexpr std::size_t MAX_CHANNELS{4096};
+    static constexpr std::size_t MAX_GROUPS{256};
+
+    // Opens or creates the file; throws std::runtime_error on failure
+    explicit StateSnapshot(const std::string &path);
+    ~StateSnapshot();
+
+    StateSnapshot(const StateSnapshot &) = delete;
+    StateSnapshot &operator=(const StateSnapshot &) = delete;
+
+    // Reads the newest intact copy; false if the file has none
+    bool load(EngineState &state) const;
+    void save(const EngineState &state);
+
+    const std::string &path() const { return m_path; }
+
+private:
+    struct Copy;
+
+    Copy *copy(std::size_t index) const;
+    static std::uint32_t checksum(const Copy &copy, std::uint64_t sequence);
+
+    std::string m_path;
+    std::uint8_t *m_memory{nullptr};
+    std::size_t m_bytes{0};
+    std::uint64_t m_sequence{0}; // Of the newest copy
+};
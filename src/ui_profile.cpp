@@ -0,0 +1,41 @@
+#include "ui_profile.h"
+
+#include <cstdlib> // std::getenv
+#include <string>  // DISPLAY parsing
+
+UiProfile localUiProfile()
+{
+    return UiProfile{};
+}
+
+/**
+ * A few repaints per second are enough to follow the LEDs remotely and keep
+ * the X11 traffic bounded no matter how fast the engine changes duties.
+ */
+UiProfile remoteUiProfile()
+{
+    UiProfile profile;
+    profile.remote = true;
+    profile.modelFlushMs = 100;
+    profile.previewRefreshMs = 200;
+    profile.scopeScrollMs = 250;
+    profile.styleSheets = false;
+    return profile;
+}
+
+/**
+ * A local display looks like ":0" or "unix:0". ssh -X sets DISPLAY to
+ * "localhost:10.0", and any other host name also means network X11.
+ */
+bool isForwardedDisplay()
+{
+    const char *display{std::getenv("DISPLAY")};
+    if (display == nullptr)
+    {
+        return false;
+    }
+
+    const std::string value{display};
+    const std::string host{value.substr(0, value.find(':'))};
+    return !host.empty() && host != "unix";
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+/**
+ * Repaint and styling budget for the GUI.
+ *
+ * The local profile favours smooth visuals. The remote profile is used when
+ * the window is shown over a forwarded X11 connection (ssh -X), where every
+ * repaint and every styled widget costs network traffic.
+ */
+struct UiProfile
+{
+    bool remote{false};
+    int modelFlushMs{16};     // How often slider positions are pushed to the view
+    int previewRefreshMs{0};  // LED preview sampling interval, 0 = display refresh rate
+    int scopeScrollMs{33};    // Duty scope repaint interval
+    bool styleSheets{true};   // Styled widgets (QStyleSheetStyle) and UI animations
+};
+
+UiProfile localUiProfile();
+UiProfile remoteUiProfile();
+
+// true when $DISPLAY points to a forwarded or network X server
+bool isForwardedDisplay();
@@ -0,0 +1,144 @@
+#include "work_pool.h"
+
+#include <pthread.h> // CPU affinity of the workers
+#include <sched.h>   // cpu_set_t
+
+WorkPool::WorkPool(std::size_t threads)
+{
+    const std::size_t count{threads > 0 ? threads : 1};
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    const unsigned cores{std::thread::hardware_concurrency()};
+    for (std::size_t i{1}; i < count; ++i)
+    {
+        m_workers.emplace_back(&WorkPool::workerLoop, this, i);
+
+        // Best effort: keep worker i on core i, away from the GUI on core 0
+        if (cores > 1)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(static_cast<int>(i % cores), &set);
+            pthread_setaffinity_np(m_workers.back().native_handle(), sizeof(set), &set);
+        }
+    }
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock{m_wakeMutex};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkPool::runErased(std::size_t count, void *context, Trampoline trampoline)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    m_context = context;
+    m_trampoline = trampoline;
+    m_remaining.store(count, std::memory_order_relaxed);
+
+    // Deal the tasks out round-robin
+    const std::size_t threads{m_queues.size()};
+    for (std::size_t t{0}; t < threads; ++t)
+    {
+        Queue &queue{*m_queues[t]};
+        const std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.tasks.clear();
+        for (std::size_t task{t}; task < count; task += threads)
+        {
+            queue.tasks.push_back(task);
+        }
+        queue.head = 0;
+        queue.tail = queue.tasks.size();
+    }
+
+    if (!m_workers.empty())
+    {
+        {
+            const std::lock_guard<std::mutex> lock{m_wakeMutex};
+            ++m_generation;
+        }
+        m_wake.notify_all();
+    }
+
+    workUntilEmpty(0);
+
+    // The last tasks may still be running on other cores; they are short
+    while (m_remaining.load(std::memory_order_acquire) > 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * Takes a task from the back of the thread's own queue, or failing that
+ * steals one from the front of another queue.
+ */
+bool WorkPool::takeTask(std::size_t self, std::size_t &task)
+{
+    {
+        Queue &own{*m_queues[self]};
+        const std::lock_guard<std::mutex> lock{own.mutex};
+        if (own.head < own.tail)
+        {
+            task = own.tasks[--own.tail];
+            return true;
+        }
+    }
+
+    const std::size_t threads{m_queues.size()};
+    for (std::size_t offset{1}; offset < threads; ++offset)
+    {
+        Queue &victim{*m_queues[(self + offset) % threads]};
+        const std::lock_guard<std::mutex> lock{victim.mutex};
+        if (victim.head < victim.tail)
+        {
+            task = victim.tasks[victim.head++];
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::workUntilEmpty(std::size_t self)
+{
+    std::size_t task{0};
+    while (takeTask(self, task))
+    {
+        m_trampoline(m_context, task);
+        m_remaining.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void WorkPool::workerLoop(std::size_t self)
+{
+    std::uint64_t seen{0};
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock{m_wakeMutex};
+            m_wake.wait(lock, [this, seen]()
+                        { return m_stopping || m_generation != seen; });
+            if (m_stopping)
+            {
+                return;
+            }
+            seen = m_generation;
+        }
+        workUntilEmpty(self);
+    }
+}
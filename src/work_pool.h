@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>             // Outstanding task count
+#include <condition_variable> // Waking idle workers
+#include <cstddef>            // std::size_t
+#include <cstdint>            // Run generation
+#include <memory>             // Per-thread queues
+#include <mutex>              // Queue locks
+#include <thread>             // Worker threads
+#include <vector>             // Queues and workers
+
+/**
+ * A small work-stealing thread pool for splitting an engine frame.
+ *
+ * run() deals the task indices out round-robin onto one queue per thread;
+ * the calling thread takes part as thread 0. Each thread works from the
+ * back of its own queue and, once that is empty, steals from the front of
+ * the others, so uneven tasks (a big zone next to small ones) still keep
+ * every core busy. run() returns when every task has finished.
+ *
+ * Workers are pinned to cores 1, 2, ... so that core 0 stays free for the
+ * GUI thread. run() must only be called from one thread at a time.
+ */
+class WorkPool
+{
+public:
+    // threads counts the caller, so WorkPool{4} starts three workers
+    explicit WorkPool(std::size_t threads);
+    ~WorkPool();
+
+    WorkPool(const WorkPool &) = delete;
+    WorkPool &operator=(const WorkPool &) = delete;
+
+    std::size_t threadCount() const { return m_queues.size(); }
+
+    // Calls task(i) for every i in [0, count) and waits for all of them
+    template <typename Task>
+    void run(std::size_t count, Task &task)
+    {
+        runErased(count, &task, [](void *context, std::size_t index)
+                  { (*static_cast<Task *>(context))(index); });
+    }
+
+private:
+    // Tasks are only added at the start of a run, so a fixed array with two ends will do
+    struct Queue
+    {
+        std::mutex mutex;
+        std::vector<std::size_t> tasks;
+        std::size_t head{0}; // Thieves take from here
+        std::size_t tail{0}; // The owner takes from here
+    };
+
+    using Trampoline = void (*)(void *, std::size_t);
+
+    void runErased(std::size_t count, void *context, Trampoline trampoline);
+    bool takeTask(std::size_t self, std::size_t &task);
+    void workUntilEmpty(std::size_t self);
+    void workerLoop(std::size_t self);
+
+    std::vector<std::unique_ptr<Queue>> m_queues; // [0] belongs to the caller of run()
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::uint64_t m_generation{0}; // Bumped by every run(), guarded by m_wakeMutex
+    bool m_stopping{false};
+
+    // The current run; published to workers through the queue locks
+    void *m_context{nullptr};
+    Trampoline m_trampoline{nullptr};
+    std::atomic<std::size_t> m_remaining{0};
+};